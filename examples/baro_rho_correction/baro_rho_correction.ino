@@ -191,14 +191,19 @@ const char *waterPressureVarCode = "CorrectedPressure";
 Variable *calcWaterPress = new Variable(calculateWaterPressure, waterPressureVarResolution,
                                         waterPressureVarName, waterPressureVarUnit,
                                         waterPressureVarCode, waterPressureUUID);
+// List the variables the water pressure is calculated from, so it is calculated after them
+Variable *waterPressureInputs[] = {ms5803Press, bme280Press};
 
 // Create the function to calculate the "raw" water depth
 // For this, we're using the conversion between mbar and mm pure water at 4°C
 // This calculation gives a final result in mm of water
+// The water pressure is only calculated once per update, so getting the value
+// of the calculated variable is cheaper than calling its function again.
 float calculateWaterDepthRaw(void)
 {
-    float waterDepth = calculateWaterPressure()*10.1972;
-    if (calculateWaterPressure() == -9999) waterDepth = -9999;
+    float waterPressure = calcWaterPress->getValue();
+    float waterDepth = waterPressure*10.1972;
+    if (waterPressure == -9999) waterDepth = -9999;
     // Serial.print(F("'Raw' water depth is "));  // for debugging
     // Serial.println(waterDepth);  // for debugging
     return waterDepth;
@@ -216,6 +221,7 @@ Variable *calcRawDepth = new Variable(calculateWaterDepthRaw,
                                       waterDepthVarUnit,
                                       waterDepthVarCode,
                                       waterDepthUUID);
+Variable *waterDepthInputs[] = {calcWaterPress};
 
 // Create the function to calculate the water depth after correcting water density for temperature
 // This calculation gives a final result in mm of water
@@ -223,7 +229,8 @@ float calculateWaterDepthTempCorrected(void)
 {
     const float gravitationalConstant = 9.80665;  // m/s2, meters per second squared
     // First get water pressure in Pa for the calculation: 1 mbar = 100 Pa
-    float waterPressurePa = 100 * calculateWaterPressure();
+    float waterPressure = calcWaterPress->getValue();
+    float waterPressurePa = 100 * waterPressure;
     float waterTempertureC = ms5803Temp->getValue();
     // Converting water depth for the changes of pressure with depth
     // Water density (kg/m3) from equation 6 from JonesHarris1992-NIST-DensityWater.pdf
@@ -236,7 +243,7 @@ float calculateWaterDepthTempCorrected(void)
     // This calculation gives a final result in mm of water
     // from P = rho * g * h
     float rhoDepth = 1000 * waterPressurePa/(waterDensity * gravitationalConstant);
-    if (calculateWaterPressure() == -9999 || waterTempertureC == -9999)
+    if (waterPressure == -9999 || waterTempertureC == -9999)
         rhoDepth = -9999;
     // Serial.print(F("Temperature corrected water depth is "));  // for debugging
     // Serial.println(rhoDepth);  // for debugging
@@ -255,6 +262,7 @@ Variable *calcCorrDepth = new Variable(calculateWaterDepthTempCorrected,
                                        rhoDepthVarUnit,
                                        rhoDepthVarCode,
                                        rhoDepthUUID);
+Variable *rhoDepthInputs[] = {calcWaterPress, ms5803Temp};
 
 
 // ==========================================================================
@@ -382,6 +390,12 @@ void setup()
     modem.setModemLED(modemLEDPin);
     dataLogger.setLoggerPins(wakePin, sdCardSSPin, sdCardPwrPin, buttonPin, greenLED);
 
+    // Tell the calculated variables what they're calculated from
+    // This must be done before the logger begins.
+    calcWaterPress->setInputs(waterPressureInputs, 2);
+    calcRawDepth->setInputs(waterDepthInputs, 1);
+    calcCorrDepth->setInputs(rhoDepthInputs, 2);
+
     // Begin the logger
     dataLogger.begin();
 
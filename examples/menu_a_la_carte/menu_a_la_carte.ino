@@ -32,6 +32,8 @@ const char *sketchName = "menu_a_la_carte.ino";
 // Logger ID, also becomes the prefix for the name of the data file on SD card
 const char *LoggerID = "XXXXX";
 // How frequently (in minutes) to log data
+// For an interval in seconds, call dataLogger.setLoggingIntervalSeconds() in
+// setup, after the logger is created.
 const uint8_t loggingInterval = 5;
 // Your logger's timezone.
 const int8_t timeZone = -5;  // Eastern Standard Time
@@ -53,6 +55,11 @@ const int8_t wakePin = A7;        // MCU interrupt/alarm pin to wake from sleep
 const int8_t sdCardPwrPin = -1;    // MCU SD card power pin (-1 if not applicable)
 const int8_t sdCardSSPin = 12;     // MCU SD card chip select/slave select pin (must be given!)
 const int8_t sensorPowerPin = 22;  // MCU pin controlling main sensor power (-1 if not applicable)
+// To keep the board from browning out as the sensors are switched on, give the
+// most current the board can supply and the inrush and steady current of each
+// power pin in setup(); the pins are then switched on one after another.
+//     PowerRail::setCurrentLimit(500);  // mA
+//     PowerRail::getRail(sensorPowerPin)->setCurrentDraw(350, 120);  // mA
 
 // Create the main processor chip "sensor" - for general metadata
 const char *mcuBoardVersion = "v0.5b";
@@ -670,6 +677,12 @@ const uint8_t VoltReadsToAvg = 1;  // Only read one sample
 // Create an External Voltage sensor object
 ExternalVoltage extvolt(ADSPower, ADSChannel, dividerGain, ADSi2c_addr, VoltReadsToAvg);
 
+// Create a shared ADC and External Voltage sensor objects on it (use this form
+// for several channels on the same ADS - conversions will be taken back-to-back
+// without blocking, optionally using the ALERT/RDY pin)
+// ExternalVoltageADC ads(ADSi2c_addr, ADS1X15_DR_DEFAULT, -1);
+// ExternalVoltage extvolt(ADSPower, ads, ADSChannel, dividerGain, VoltReadsToAvg);
+
 // Create a voltage variable pointer
 // Variable *extvoltV = new ExternalVoltage_Volt(&extvolt, "12345678-abcd-1234-ef00-1234567890ab");
 
@@ -716,6 +729,34 @@ MaxBotixSonar sonar1(sonarSerial, SonarPower, Sonar1Trigger) ;
 // Create an ultrasonic range variable pointer
 // Variable *sonar1Range = new MaxBotixSonar_Range(&sonar1, "12345678-abcd-1234-ef00-1234567890ab");
 
+// To report the median of the averaged readings and their standard deviation,
+// create a statistics object with room for 10 samples of each variable...
+// #include <SensorStatistics.h>
+// SensorStatisticsBuffer<10> sonar1Stats;
+// ...a variable for the standard deviation in an unused result number...
+// Variable *sonar1RangeStdev = new Variable(&sonar1, 1, 0, "distance", "millimeter",
+//                                           "SonarRangeStdDev", "12345678-abcd-1234-ef00-1234567890ab");
+// ...and in setup() attach it and choose the statistics:
+//     sonar1.setStatistics(sonar1Stats);
+//     sonar1Stats.setAggregation(HRXL_VAR_NUM, STAT_MEDIAN);
+//     sonar1Stats.addDerivedResult(HRXL_VAR_NUM, STAT_STDDEV, 1);
+// To stop averaging early once the standard error is below 2mm, or the last
+// three readings are within 5mm of each other (after at least 3 readings):
+//     sonar1Stats.setConvergence(HRXL_VAR_NUM, 2.0, 3);
+//     sonar1Stats.setConvergenceWindow(3, 5.0);
+
+// To see how long the sonar is powered each interval and estimate the charge
+// it uses, create a telemetry object with its current draw (in mA)...
+// #include <SensorTelemetry.h>
+// SensorTelemetry sonar1Telemetry(3.4);
+// ...a variable for the charge in an unused result number...
+// Variable *sonar1Charge = new Variable(&sonar1, 2, 5, "electricCharge", "milliampHour",
+//                                       "SonarCharge", "12345678-abcd-1234-ef00-1234567890ab");
+// ...and in setup() attach it:
+//     sonar1.setTelemetry(sonar1Telemetry);
+//     sonar1Telemetry.addDiagnosticResult(TELEM_CHARGE_MAH, 2);
+// The telemetry of every sensor that has it is also printed in testing mode.
+
 
 // const int8_t Sonar2Trigger = A2;  // Trigger pin (a unique negative number if unconnected) (D26 = A2)
 // MaxBotixSonar sonar2(sonarSerial, SonarPower, Sonar2Trigger) ;
@@ -740,6 +781,11 @@ MaximDS18 ds18(OneWireAddress1, OneWirePower, OneWireBus);
 // Create a Maxim DS18 sensor object (use this form for a single sensor on bus with an unknown address)
 // MaximDS18 ds18(OneWirePower, OneWireBus);
 
+// Create a shared bus and Maxim DS18 sensor objects on it (use this form for
+// many sensors on the same bus - all will be measured with a single conversion)
+// MaximDS18Bus ds18Bus(OneWirePower, OneWireBus);
+// MaximDS18 ds18(OneWireAddress1, ds18Bus);
+
 // Create a temperature variable pointer for the DS18
 // Variable *ds18Temp = new MaximDS18_Temp(&ds18, "12345678-abcd-1234-ef00-1234567890ab");
 
@@ -1139,6 +1185,33 @@ const char *calculatedVarUUID = "12345678-abcd-1234-ef00-1234567890ab";  // The
 Variable *calculatedVar = new Variable(calculateVariableValue, calculatedVarResolution,
                                        calculatedVarName, calculatedVarUnit,
                                        calculatedVarCode, calculatedVarUUID);
+// On an AVR board, the strings above all take up RAM.  To keep them in flash
+// instead, declare them in a metadata table and create the variable from it:
+// MS_VARIABLE_METADATA(calculatedVarMeta, "varName", "varUnit", 3, "calcVar",
+//                      "12345678-abcd-1234-ef00-1234567890ab");
+// Variable *calculatedVar = new Variable(calculateVariableValue, &calculatedVarMeta);
+// The same works for a measured variable:
+// MS_VARIABLE_METADATA(ds18TempMeta, "temperature", "degreeCelsius", 4, "DS18Temp",
+//                      "12345678-abcd-1234-ef00-1234567890ab");
+// Variable *ds18Temp = new Variable(&ds18, DS18_TEMP_VAR_NUM, &ds18TempMeta);
+// To have the array calculate this after the variables it uses, list them and
+// in setup() (before the logger begins) attach the list:
+// Variable *calculatedVarInputs[] = {variable1, variable2};
+//     calculatedVar->setInputs(calculatedVarInputs, 2);
+
+// A calculation can also be given its own previous value and the milliseconds
+// since it was last calculated, for example to keep a running total.  The time
+// is taken from the clock time given to each update (as the loop below does
+// with varArray.completeUpdate(Logger::markedEpochTime)):
+// float calculateRunningTotal(float previousValue, uint32_t elapsed_ms)
+// {
+//     float flowRate = variable1->getValue();
+//     if (previousValue == -9999) previousValue = 0;
+//     if (flowRate == -9999) return previousValue;
+//     return previousValue + flowRate*elapsed_ms/1000.0;
+// }
+// Variable *runningTotal = new Variable(calculateRunningTotal, 1, "volume", "liter",
+//                                       "TotalVolume", "12345678-abcd-1234-ef00-1234567890ab");
 
 
 // ==========================================================================
@@ -1260,6 +1333,12 @@ int variableCount = sizeof(variableList) / sizeof(variableList[0]);
 // Create the VariableArray object
 VariableArray varArray(variableCount, variableList);
 
+// OPTIONAL:  Keep the latest values of all of the variables together in one
+// store, so records are read straight from it instead of through each variable.
+// The store must have room for every variable in the array.
+// VariableValueBuffer<40> valueStore;
+// (in setup) varArray.setValueStore(valueStore);
+
 
 // ==========================================================================
 //     The Logger Object[s]
@@ -1269,6 +1348,27 @@ VariableArray varArray(variableCount, variableList);
 // Create a new logger instance
 Logger dataLogger(LoggerID, loggingInterval, &varArray);
 
+// OPTIONAL:  Keep the most recent records in RAM, so they can be read back by
+// the SD card writer and publishers after the sensors have moved on.
+// This buffer holds 10 records of up to 40 variables each (1650 bytes).
+// LoggerRecordRing<10, 40> recordBuffer;
+// (in setup) dataLogger.setRecordBuffer(recordBuffer);
+
+// OPTIONAL:  Log faster during events.  When any trigger fires, the logger logs
+// every 10 seconds until 60 minutes have passed without a trigger firing.
+// LoggerTrigger stageTrigger(variableList[0], TRIGGER_ABOVE, 1.5);
+// LoggerTrigger stageRiseTrigger(variableList[0], TRIGGER_RISING, 0.01);  // per minute
+// (in setup) dataLogger.setBurstMode(10, 60);
+// (in setup) dataLogger.addTrigger(stageTrigger);
+// (in setup) dataLogger.addTrigger(stageRiseTrigger);
+
+// OPTIONAL:  Keep the clock on time between syncs by trimming its drift, rather
+// than only setting it at each sync.  Bad times from the modem are ignored, and
+// the clock is only synced as often as needed to stay within 2 seconds, up to
+// every 30 days.
+// ClockDiscipline clockDiscipline(2, 30);
+// (in setup) dataLogger.setClockDiscipline(clockDiscipline);
+
 
 // ==========================================================================
 //    A Publisher to Monitor My Watershed / EnviroDIY Data Sharing Portal
@@ -1454,7 +1554,7 @@ void setup()
             Serial.println(F("Attempting to connect to the internet and synchronize RTC with NIST"));
             if (modem.connectInternet(120000L))
             {
-                dataLogger.setRTClock(modem.getNISTTime());
+                dataLogger.disciplineRTClock(modem.getNISTTime());
             }
         }
     }
@@ -1551,12 +1651,30 @@ void loop()
         // Power up the SD Card, but skip any waits after power up
         dataLogger.turnOnSDcard(false);
 
+        // Check if any of the publishers are due to send data or if it's time
+        // to sync the clock.  If not, the modem can stay off.
+        // Set the schedule for each publisher with setSendFrequency(),
+        // addSendTime() and setBacklogThreshold(), ie:
+        //   EnviroDIYPOST.setSendFrequency(6, 0);  // every 6th interval
+        //   EnviroDIYPOST.addSendTime(12, 0);  // and at noon
+        // The record about to be saved to the record buffer, if there is one,
+        // counts towards the publishers' backlogs.
+        bool publishDue = dataLogger.checkPublishersDue(
+            dataLogger.getRecordBuffer() != NULL ? 1 : 0);
+        // Sync the clock at midnight, if it's due
+        bool syncDue = Logger::markedEpochTime != 0 &&
+                       Logger::markedEpochTime % 86400 == 0 &&
+                       (dataLogger.getClockDiscipline() == NULL ||
+                        dataLogger.getClockDiscipline()->isSyncDue(Logger::markedEpochTime -
+                            ((uint32_t)Logger::getLoggerTimeZone())*3600));
+        bool modemNeeded = publishDue || syncDue;
+
         // Turn on the modem to let it start searching for the network
         // Only turn the modem on if the battery at the last interval was high enough
         // NOTE:  if the modemPowerUp function is not run before the completeUpdate
         // function is run, the modem will not be powered and will not return
         // a signal strength reading.
-        if (getBatteryVoltage() > 3.6)
+        if (modemNeeded && getBatteryVoltage() > 3.6)
             modem.modemPowerUp();
 
         // Do a complete update on the variable array.
@@ -1564,25 +1682,30 @@ void loop()
         // values, and turing them back off.
         // NOTE:  The wake function for each sensor should force sensor setup
         // to run if the sensor was not previously set up.
-        varArray.completeUpdate();
+        varArray.completeUpdate(Logger::markedEpochTime);
+
+        // Keep a copy of the record in the record buffer, if there is one
+        dataLogger.saveRecord();
+        // Start or extend a burst if any trigger fires
+        dataLogger.checkTriggers();
 
         // Create a csv data record and save it to the log file
         dataLogger.logToSD();
 
         // Connect to the network
         // Again, we're only doing this if the battery is doing well
-        if (getBatteryVoltage() > 3.7)
+        if (modemNeeded && getBatteryVoltage() > 3.7)
         {
             if (modem.connectInternet())
             {
-                // Publish data to remotes
-                dataLogger.publishDataToRemotes();
+                // Publish data to all of the remotes that are due
+                if (publishDue) dataLogger.publishDataToRemotes();
 
-                // Sync the clock at midnight
-                if (Logger::markedEpochTime != 0 && Logger::markedEpochTime % 86400 == 0)
+                // Sync the clock
+                if (syncDue)
                 {
                     Serial.println(F("Running a daily clock sync..."));
-                    dataLogger.setRTClock(modem.getNISTTime());
+                    dataLogger.disciplineRTClock(modem.getNISTTime());
                 }
 
                 // Disconnect from the network
@@ -0,0 +1,218 @@
+/*
+ *ClockDiscipline.cpp
+ *This file is part of the EnviroDIY modular sensors library for Arduino
+ *
+ *Initial library developement done by Sara Damiano (sdamiano@stroudcenter.org).
+ *
+ *This file is for keeping the real time clock on time between syncs with an
+ *outside time source (ie, NIST over the modem) without simply stepping it.
+*/
+
+#include "ClockDiscipline.h"
+
+#if defined MS_SAMD_DS3231 || not defined ARDUINO_ARCH_SAMD
+#include <Wire.h>
+#include <Sodaq_DS3231.h>
+// The I2C address of the DS3231 and its aging offset register
+#define DS3231_ADDRESS 0x68
+#define DS3231_AGING_REGISTER 0x10
+#endif
+
+// After this many rejected samples in a row, the clock itself is more likely
+// wrong (ie, it lost power) than the source, so the next sample is trusted.
+#define CLOCK_MAX_REJECTED_IN_A_ROW 3
+
+
+ClockDiscipline::ClockDiscipline(uint8_t maxErrorSeconds, uint8_t maxSyncDays)
+{
+    _maxErrorSeconds = maxErrorSeconds;
+    _maxSyncDays = maxSyncDays;
+
+    _hasBaseline = false;
+    _baselineSource = 0;
+    _baselineError = 0;
+    _stepsSinceBaseline = 0;
+
+    _pendingStep = 0;
+    _driftPPM = 0;
+    _driftSpan = 0;
+    _driftKnown = false;
+    _lastSyncTime = 0;
+    _rejectedCount = 0;
+    _rejectedInARow = 0;
+}
+ClockDiscipline::~ClockDiscipline(){}
+
+
+bool ClockDiscipline::addTimeSample(uint32_t sourceUTC, uint32_t clockUTC)
+{
+    // Sources give 0 when they fail, and nothing sane is from before the library
+    if (sourceUTC < CLOCK_MIN_VALID_EPOCH)
+    {
+        MS_DBG(F("Rejecting time"), sourceUTC, F("from before 2018"));
+        _rejectedCount++;
+        return false;
+    }
+
+    // Positive when the clock is ahead of the source
+    int32_t clockError = (int32_t)(clockUTC - sourceUTC);
+    MS_DBG(F("Clock is off by"), clockError, F("seconds"));
+
+    if (_hasBaseline && _rejectedInARow < CLOCK_MAX_REJECTED_IN_A_ROW)
+    {
+        // The error can only have changed by the steps taken and the drift
+        int32_t change = clockError - _baselineError - _stepsSinceBaseline;
+        float allowed = 2 + (float)(sourceUTC - _baselineSource)*CLOCK_MAX_DRIFT_PPM/1000000L;
+        if (sourceUTC <= _baselineSource || abs(change) > allowed)
+        {
+            MS_DBG(F("Rejecting time"), sourceUTC, F("; clock error changed by"),
+                   change, F("seconds, more than drift allows"));
+            _rejectedCount++;
+            _rejectedInARow++;
+            return false;
+        }
+    }
+    else if (_hasBaseline)
+    {
+        MS_DBG(F("Too many rejected times, trusting this one"));
+        _hasBaseline = false;
+    }
+    _rejectedInARow = 0;
+
+    // The sample measures all of the error, including any step not yet taken
+    _pendingStep = -clockError;
+    _lastSyncTime = sourceUTC;
+
+    if (!_hasBaseline)
+    {
+        _hasBaseline = true;
+        _baselineSource = sourceUTC;
+        _baselineError = clockError;
+        _stepsSinceBaseline = 0;
+    }
+    else correctDrift(sourceUTC, clockError);
+
+    return true;
+}
+
+
+void ClockDiscipline::correctDrift(uint32_t sourceUTC, int32_t clockError)
+{
+    uint32_t span = sourceUTC - _baselineSource;
+    if (span < CLOCK_MIN_DRIFT_SPAN) return;
+
+    // The seconds the clock gained on its own since the baseline
+    int32_t gained = clockError - _baselineError - _stepsSinceBaseline;
+    _driftPPM = (float)gained*1000000L/span;
+    _driftSpan = span;
+    _driftKnown = true;
+    MS_DBG(F("Clock gained"), gained, F("seconds in"), span, F("seconds, or"),
+           _driftPPM, F("ppm"));
+
+    // A second either way is just the rounding of the samples, so keep the
+    // baseline and let the span grow until the drift shows
+    if (abs(gained) < 2) return;
+
+    int8_t agingOffset;
+    if (readAgingOffset(agingOffset))
+    {
+        // A higher aging offset slows the clock
+        int16_t newOffset = agingOffset + (int16_t)round(_driftPPM/CLOCK_PPM_PER_AGING_STEP);
+        if (newOffset > 127) newOffset = 127;
+        if (newOffset < -128) newOffset = -128;
+        if (newOffset != agingOffset && writeAgingOffset(newOffset))
+        {
+            MS_DBG(F("Changed aging offset from"), agingOffset, F("to"), newOffset);
+        }
+    }
+
+    // Measure from here on, at the new rate
+    _baselineSource = sourceUTC;
+    _baselineError = clockError;
+    _stepsSinceBaseline = 0;
+}
+
+
+bool ClockDiscipline::isSyncDue(uint32_t clockUTC)
+{
+    if (!_hasBaseline) return true;
+
+    // Never count on less drift than could hide in the rounding of the samples
+    float drift = CLOCK_DEFAULT_DRIFT_PPM;
+    if (_driftKnown)
+    {
+        drift = fabs(_driftPPM);
+        float resolution = 1000000.0/_driftSpan;
+        if (drift < resolution) drift = resolution;
+    }
+
+    uint32_t holdSeconds = (float)_maxErrorSeconds*1000000L/drift;
+    uint32_t maxHoldSeconds = (uint32_t)_maxSyncDays*86400L;
+    if (holdSeconds > maxHoldSeconds) holdSeconds = maxHoldSeconds;
+
+    // Syncs are tried once a day, so don't wait if tomorrow would be too late
+    return clockUTC - _lastSyncTime + 86400L > holdSeconds;
+}
+
+
+int32_t ClockDiscipline::takeSafeStep(uint32_t now, uint32_t lastDueTime,
+                                      uint32_t nextDueTime)
+{
+    int32_t step = _pendingStep;
+    if (step > 0)
+    {
+        // Leave a margin so the clock still reaches the next time itself
+        int32_t room = (int32_t)(nextDueTime - now) - 2;
+        if (room < 0) room = 0;
+        if (step > room) step = room;
+    }
+    else if (step < 0)
+    {
+        // Don't go back as far as the last time, or it would be logged again
+        int32_t room = (int32_t)(now - lastDueTime) - 1;
+        if (room < 0) room = 0;
+        if (-step > room) step = -room;
+    }
+    takeStep(step);
+    return step;
+}
+
+
+void ClockDiscipline::takeStep(int32_t step)
+{
+    _pendingStep -= step;
+    _stepsSinceBaseline += step;
+}
+
+
+bool ClockDiscipline::readAgingOffset(int8_t& agingOffset)
+{
+#if defined MS_SAMD_DS3231 || not defined ARDUINO_ARCH_SAMD
+    Wire.beginTransmission(DS3231_ADDRESS);
+    Wire.write(DS3231_AGING_REGISTER);
+    if (Wire.endTransmission() != 0) return false;
+    if (Wire.requestFrom(DS3231_ADDRESS, 1) != 1) return false;
+    agingOffset = (int8_t)Wire.read();
+    return true;
+#else
+    // The SAMD built-in clock has no aging offset
+    agingOffset = 0;
+    return false;
+#endif
+}
+
+
+bool ClockDiscipline::writeAgingOffset(int8_t agingOffset)
+{
+#if defined MS_SAMD_DS3231 || not defined ARDUINO_ARCH_SAMD
+    Wire.beginTransmission(DS3231_ADDRESS);
+    Wire.write(DS3231_AGING_REGISTER);
+    Wire.write((uint8_t)agingOffset);
+    if (Wire.endTransmission() != 0) return false;
+    // The new offset only takes effect at the next temperature conversion
+    rtc.convertTemperature();
+    return true;
+#else
+    return false;
+#endif
+}
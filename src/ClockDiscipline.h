@@ -0,0 +1,117 @@
+/*
+ *ClockDiscipline.h
+ *This file is part of the EnviroDIY modular sensors library for Arduino
+ *
+ *Initial library developement done by Sara Damiano (sdamiano@stroudcenter.org).
+ *
+ *This file is for keeping the real time clock on time between syncs with an
+ *outside time source (ie, NIST over the modem) without simply stepping it.
+ *
+ *Each time sample from the source is checked before it's used:  it must be a
+ *plausible date and, once there's an earlier good sample, the clock's error
+ *must not have changed by more than any working clock could drift.  Samples
+ *that fail are rejected and the clock is left alone.
+ *
+ *The change in the clock's error between good samples at least a few days
+ *apart gives its drift.  On a DS3231, the drift is corrected by adjusting the
+ *aging offset register, which trims the crystal by about 0.1ppm a step.
+ *
+ *The error itself is not stepped out right away.  The logger takes it off
+ *when it goes to sleep, only as much at a time as keeps the clock from
+ *crossing an interval time it has already logged or is about to log, so no
+ *interval is skipped or logged twice.  Errors longer than an interval (ie,
+ *a clock that was never set) are stepped out immediately.
+ *
+ *The better the drift is known, the longer the clock stays within the allowed
+ *error, so the fewer syncs (and modem sessions) are needed.
+*/
+
+// Header Guards
+#ifndef ClockDiscipline_h
+#define ClockDiscipline_h
+
+// Debugging Statement
+// #define MS_CLOCKDISCIPLINE_DEBUG
+
+#ifdef MS_CLOCKDISCIPLINE_DEBUG
+#define MS_DEBUGGING_STD "ClockDiscipline"
+#endif
+
+// Included Dependencies
+#include "ModSensorDebugger.h"
+#undef MS_DEBUGGING_STD
+
+// The earliest time a source can give, 2018-01-01 00:00:00 UTC
+#define CLOCK_MIN_VALID_EPOCH 1514764800L
+// More drift than any working clock would have, in ppm
+#define CLOCK_MAX_DRIFT_PPM 100
+// The drift a DS3231 can have before it's been measured, in ppm
+#define CLOCK_DEFAULT_DRIFT_PPM 2
+// The shortest time between samples to measure the drift from, in seconds
+// Samples are whole seconds, so shorter times can't resolve a few ppm.
+#define CLOCK_MIN_DRIFT_SPAN 432000L  // 5 days
+// The change of the drift for each step of the DS3231 aging offset, in ppm
+#define CLOCK_PPM_PER_AGING_STEP 0.1
+
+
+class ClockDiscipline
+{
+public:
+    // maxErrorSeconds is how far the clock may be allowed to wander before a
+    // sync, and maxSyncDays the longest to ever go between syncs
+    ClockDiscipline(uint8_t maxErrorSeconds = 2, uint8_t maxSyncDays = 30);
+    ~ClockDiscipline();
+
+    // This takes a time from the outside source and the clock's time at the
+    // same moment, both in UTC.  Returns false if the sample was rejected.
+    bool addTimeSample(uint32_t sourceUTC, uint32_t clockUTC);
+
+    // This checks if the clock needs to be synced again
+    bool isSyncDue(uint32_t clockUTC);
+
+    // The seconds still to be added to the clock
+    int32_t getPendingStep(void){return _pendingStep;}
+    // This returns as much of the pending step as can be added to the clock
+    // at the given time without reaching either the last time or the next
+    // time that the logger is due, and counts it as applied.
+    int32_t takeSafeStep(uint32_t now, uint32_t lastDueTime, uint32_t nextDueTime);
+    // This counts a step of the given seconds as applied, whole
+    // The clock must be set just as a second starts (as the logger does) or
+    // the part of the second lost in setting it will look like drift.
+    void takeStep(int32_t step);
+
+    // The last measured drift of the clock, in ppm.  Positive is fast.
+    float getDriftPPM(void){return _driftPPM;}
+    bool isDriftKnown(void){return _driftKnown;}
+    uint32_t getLastSyncTime(void){return _lastSyncTime;}
+    uint16_t getRejectedCount(void){return _rejectedCount;}
+
+    // These read and set the aging offset on a DS3231
+    // They return false if there's no DS3231 or it can't be reached.
+    static bool readAgingOffset(int8_t& agingOffset);
+    static bool writeAgingOffset(int8_t agingOffset);
+
+protected:
+    // This corrects the drift, if it's been measured well enough
+    void correctDrift(uint32_t sourceUTC, int32_t clockError);
+
+    uint8_t _maxErrorSeconds;
+    uint8_t _maxSyncDays;
+
+    // The sample the drift is measured from
+    bool _hasBaseline;
+    uint32_t _baselineSource;
+    int32_t _baselineError;
+    // The seconds added to the clock since the baseline sample
+    int32_t _stepsSinceBaseline;
+
+    int32_t _pendingStep;
+    float _driftPPM;
+    uint32_t _driftSpan;  // The seconds the drift was measured over
+    bool _driftKnown;
+    uint32_t _lastSyncTime;
+    uint16_t _rejectedCount;
+    uint8_t _rejectedInARow;
+};
+
+#endif  // Header Guard
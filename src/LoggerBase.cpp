@@ -23,12 +23,19 @@
 int8_t Logger::_loggerTimeZone = 0;
 // Initialize the static time adjustment
 int8_t Logger::_loggerRTCOffset = 0;
+// Initialize the time zone suffix for UTC and the empty timestamp cache
+char Logger::_timeZoneSuffix[7] = "Z";
+char Logger::_iso8601Cache[ISO8601_BUFFER_SIZE] = "";
+uint32_t Logger::_iso8601CacheTime = 0;
 // Initialize the static timestamps
 uint32_t Logger::markedEpochTime = 0;
 // Initialize the testing/logging flags
 volatile bool Logger::isLoggingNow = false;
 volatile bool Logger::isTestingNow = false;
 volatile bool Logger::startTesting = false;
+// Initialize the wake flag and counters
+volatile bool Logger::_clockWake = false;
+uint32_t Logger::_quickWakeCount = 0;
 
 // Initialize the RTC for the SAMD boards
 #if defined(ARDUINO_ARCH_SAMD)
@@ -64,11 +71,33 @@ Logger::Logger(const char *loggerID, uint16_t loggingIntervalMinutes,
     // Start with no feature UUID
     _samplingFeatureUUID = NULL;
 
+    // Start with no record buffer
+    _recordBuffer = NULL;
+    _recordSelected = false;
+    _selectedRecord = 0;
+
     // Clear arrays
     for (uint8_t i = 0; i < MAX_NUMBER_SENDERS; i++)
     {
         dataPublishers[i] = NULL;
     }
+    _publishersDue = 0;
+    _publishersDueTime = 0;
+
+    // Start with no bursts
+    for (uint8_t i = 0; i < MAX_NUMBER_TRIGGERS; i++)
+    {
+        _triggers[i] = NULL;
+    }
+    _burstIntervalSeconds = 0;
+    _burstDurationMinutes = 0;
+    _burstEndTime = 0;
+
+    // No alarm set yet
+    _nextAlarmTime = 0;
+
+    // No clock discipline until one is attached
+    _clockDiscipline = NULL;
 
     // MS_DBG(F("Logger object created"));
 }
@@ -98,11 +127,33 @@ Logger::Logger(const char *loggerID, uint16_t loggingIntervalMinutes,
     // Start with no feature UUID
     _samplingFeatureUUID = NULL;
 
+    // Start with no record buffer
+    _recordBuffer = NULL;
+    _recordSelected = false;
+    _selectedRecord = 0;
+
     // Clear arrays
     for (uint8_t i = 0; i < MAX_NUMBER_SENDERS; i++)
     {
         dataPublishers[i] = NULL;
     }
+    _publishersDue = 0;
+    _publishersDueTime = 0;
+
+    // Start with no bursts
+    for (uint8_t i = 0; i < MAX_NUMBER_TRIGGERS; i++)
+    {
+        _triggers[i] = NULL;
+    }
+    _burstIntervalSeconds = 0;
+    _burstDurationMinutes = 0;
+    _burstEndTime = 0;
+
+    // No alarm set yet
+    _nextAlarmTime = 0;
+
+    // No clock discipline until one is attached
+    _clockDiscipline = NULL;
 
     // MS_DBG(F("Logger object created"));
 }
@@ -126,11 +177,33 @@ Logger::Logger()
     // Start with no feature UUID
     _samplingFeatureUUID = NULL;
 
+    // Start with no record buffer
+    _recordBuffer = NULL;
+    _recordSelected = false;
+    _selectedRecord = 0;
+
     // Clear arrays
     for (uint8_t i = 0; i < MAX_NUMBER_SENDERS; i++)
     {
         dataPublishers[i] = NULL;
     }
+    _publishersDue = 0;
+    _publishersDueTime = 0;
+
+    // Start with no bursts
+    for (uint8_t i = 0; i < MAX_NUMBER_TRIGGERS; i++)
+    {
+        _triggers[i] = NULL;
+    }
+    _burstIntervalSeconds = 0;
+    _burstDurationMinutes = 0;
+    _burstEndTime = 0;
+
+    // No alarm set yet
+    _nextAlarmTime = 0;
+
+    // No clock discipline until one is attached
+    _clockDiscipline = NULL;
 
     // MS_DBG(F("Logger object created"));
 }
@@ -152,7 +225,13 @@ void Logger::setLoggerID(const char *loggerID)
 // Sets/Gets the logging interval
 void Logger::setLoggingInterval(uint16_t loggingIntervalMinutes)
 {
-    _loggingIntervalMinutes = loggingIntervalMinutes;
+    setLoggingIntervalSeconds((uint32_t)loggingIntervalMinutes*60);
+}
+void Logger::setLoggingIntervalSeconds(uint32_t loggingIntervalSeconds)
+{
+    // An interval of 0 would never come around
+    if (loggingIntervalSeconds == 0) loggingIntervalSeconds = 60;
+    _loggingIntervalSeconds = loggingIntervalSeconds;
 }
 
 
@@ -337,11 +416,63 @@ String Logger::getVarUUIDAtI(uint8_t position_i)
 {
     return _internalArray->arrayOfVars[position_i]->getVarUUID();
 }
-// This returns the current value of the variable as a string with the
-// correct number of significant figures
+// This returns the value of the variable in the selected record, or its
+// current value, as a string with the correct number of significant figures
 String Logger::getValueStringAtI(uint8_t position_i)
 {
-    return _internalArray->arrayOfVars[position_i]->getValueString();
+    if (_recordSelected && _recordBuffer->hasRecord(_selectedRecord))
+    {
+        return _internalArray->formatValueString(position_i,
+            _recordBuffer->getValue(_selectedRecord, position_i));
+    }
+    return _internalArray->getValueString(position_i);
+}
+
+
+
+// ===================================================================== //
+// Public functions for the buffer of recent records
+// ===================================================================== //
+
+// Attaches a buffer to keep the most recent records in
+void Logger::setRecordBuffer(LoggerRecordBuffer& buffer)
+{
+    _recordBuffer = &buffer;
+    _recordSelected = false;
+}
+
+
+// This copies the latest values into a new record and selects it
+uint32_t Logger::saveRecord(uint8_t flags)
+{
+    if (_recordBuffer == NULL) return 0;
+    _selectedRecord = _recordBuffer->addRecord(Logger::markedEpochTime,
+                                               _internalArray, flags);
+    _recordSelected = true;
+    return _selectedRecord;
+}
+
+
+// This selects a record in the buffer to print
+bool Logger::selectRecord(uint32_t sequence)
+{
+    if (_recordBuffer == NULL || !_recordBuffer->hasRecord(sequence))
+    {
+        MS_DBG(F("Record"), sequence, F("is not in the buffer!"));
+        return false;
+    }
+    _selectedRecord = sequence;
+    _recordSelected = true;
+    return true;
+}
+
+
+// This returns the time of the selected record
+uint32_t Logger::getRecordEpochTime(void)
+{
+    if (_recordSelected && _recordBuffer->hasRecord(_selectedRecord))
+        return _recordBuffer->getEpochTime(_selectedRecord);
+    return Logger::markedEpochTime;
 }
 
 
@@ -373,7 +504,7 @@ bool Logger::syncRTC()
         // its setup function if necessary.
         if (_logModem->connectInternet(120000L))
         {
-            success = setRTClock(_logModem->getNISTTime());
+            success = disciplineRTClock(_logModem->getNISTTime());
             // Disconnect from the network - ehh, why bother
             // _logModem->disconnectInternet();
         }
@@ -398,20 +529,99 @@ void Logger::registerDataPublisher(dataPublisher* publisher)
 }
 
 
+// This checks which publishers are due to send at the marked time
+bool Logger::checkPublishersDue(uint8_t pendingRecords)
+{
+    _publishersDue = 0;
+    _publishersDueTime = Logger::markedEpochTime;
+    for (uint8_t i = 0; i < MAX_NUMBER_SENDERS; i++)
+    {
+        if (dataPublishers[i] != NULL && dataPublishers[i]->checkSendDue(pendingRecords))
+        {
+            bitSet(_publishersDue, i);
+        }
+    }
+    MS_DBG(F("Publishers due:"), String(_publishersDue, BIN));
+    return _publishersDue != 0;
+}
+
+
 void Logger::publishDataToRemotes(void)
 {
     MS_DBG(F("Sending out remote data."));
 
+    // Check which publishers are due, unless that was already done for this
+    // record
+    if (_publishersDueTime != Logger::markedEpochTime) checkPublishersDue();
+
     for (uint8_t i = 0; i < MAX_NUMBER_SENDERS; i++)
     {
-        if (dataPublishers[i] != NULL)
+        if (dataPublishers[i] != NULL && bitRead(_publishersDue, i))
         {
             PRINTOUT(F("\nSending data to"), dataPublishers[i]->getEndpoint());
             // dataPublishers[i]->publishData(_logModem->getClient());
-            dataPublishers[i]->publishData();
+            if (_recordBuffer != NULL) publishBufferedRecords(dataPublishers[i]);
+            else dataPublishers[i]->publishData();
             watchDogTimer.resetWatchDog();
         }
     }
+    // Don't send the same data twice if called again for the same record
+    _publishersDue = 0;
+}
+
+
+// This sends all of the unsent records in the buffer to a publisher, oldest
+// first.  It stops at the first that fails in a way worth trying again (ie, no
+// connection), so it's tried again next time.  A record the receiver refuses
+// outright is skipped, so it can't hold up the rest.  If the receiver can only
+// take a few records a session, only the newest are sent.
+void Logger::publishBufferedRecords(dataPublisher *publisher)
+{
+    bool wasSelected = _recordSelected;
+    uint32_t wasRecord = _selectedRecord;
+
+    LoggerRecordSnapshot records = _recordBuffer->snapshot(publisher->getNextRecord());
+
+    // Skip any records older than the receiver can take in one session
+    uint8_t maxRecords = publisher->getMaxRecordsPerSession();
+    uint32_t skipped = 0;
+    while (maxRecords > 0 && records.getRemaining() > maxRecords && records.next())
+    {
+        publisher->setNextRecord(records.getSequence() + 1);
+        skipped++;
+    }
+    if (skipped > 0)
+    {
+        PRINTOUT(F("Skipping"), skipped, F("older records"),
+                 publisher->getEndpoint(), F("can't take in one session"));
+    }
+
+    while (records.next())
+    {
+        if (!(records.getFlags() & LOGGER_RECORD_TESTING))
+        {
+            selectRecord(records.getSequence());
+            int16_t response = publisher->publishData();
+            watchDogTimer.resetWatchDog();
+            if (publisher->publishSucceeded(response)) {}
+            else if (publisher->publishRetryable(response))
+            {
+                MS_DBG(F("Record"), records.getSequence(), F("was not accepted;"),
+                       records.getRemaining(), F("more left unsent"));
+                break;
+            }
+            else
+            {
+                PRINTOUT(F("Record"), records.getSequence(), F("was refused by"),
+                         publisher->getEndpoint(), F("with response"), response,
+                         F("and will not be sent again"));
+            }
+        }
+        publisher->setNextRecord(records.getSequence() + 1);
+    }
+
+    _recordSelected = wasSelected;
+    _selectedRecord = wasRecord;
 }
 void Logger::sendDataToRemotes(void) { publishDataToRemotes(); }
 
@@ -425,6 +635,20 @@ void Logger::sendDataToRemotes(void) { publishDataToRemotes(); }
 void Logger::setLoggerTimeZone(int8_t timeZone)
 {
     _loggerTimeZone = timeZone;
+
+    // Work out the ISO8601 time zone suffix once, rather than for every string
+    if (timeZone == 0) strcpy(_timeZoneSuffix, "Z");
+    else
+    {
+        uint8_t hours = abs(timeZone);
+        _timeZoneSuffix[0] = timeZone < 0 ? '-' : '+';
+        _timeZoneSuffix[1] = '0' + hours/10;
+        _timeZoneSuffix[2] = '0' + hours%10;
+        strcpy(&_timeZoneSuffix[3], ":00");
+    }
+    // Anything already formatted has the old time zone
+    _iso8601Cache[0] = '\0';
+
     // Some helpful prints for debugging
     #ifdef STANDARD_SERIAL_OUTPUT
         const char* prtout1 = "Logger timezone is set to UTC";
@@ -527,34 +751,9 @@ DateTime Logger::dtFromEpoch(uint32_t epochTime)
 // the LOGGER's offset as the time zone offset in the string.
 String Logger::formatDateTime_ISO8601(DateTime& dt)
 {
-    // Set up an inital string
-    String dateTimeStr;
-    // Convert the DateTime object to a String
-    dt.addToString(dateTimeStr);
-    dateTimeStr.replace(" ", "T");
-    String tzString = String(_loggerTimeZone);
-    if (-24 <= _loggerTimeZone && _loggerTimeZone <= -10)
-    {
-        tzString += F(":00");
-    }
-    else if (-10 < _loggerTimeZone && _loggerTimeZone < 0)
-    {
-        tzString = tzString.substring(0,1) + '0' + tzString.substring(1,2) + F(":00");
-    }
-    else if (_loggerTimeZone == 0)
-    {
-        tzString = 'Z';
-    }
-    else if (0 < _loggerTimeZone && _loggerTimeZone < 10)
-    {
-        tzString = "+0" + tzString + F(":00");
-    }
-    else if (10 <= _loggerTimeZone && _loggerTimeZone <= 24)
-    {
-        tzString = "+" + tzString + F(":00");
-    }
-    dateTimeStr += tzString;
-    return dateTimeStr;
+    char buffer[ISO8601_BUFFER_SIZE];
+    formatDateTime_ISO8601(dt, buffer);
+    return String(buffer);
 }
 
 
@@ -569,6 +768,56 @@ String Logger::formatDateTime_ISO8601(uint32_t epochTime)
 }
 
 
+// This writes a number into a buffer as a fixed number of digits, padded with
+// zeros, and returns the position after it
+static char *writeDigits(char *buffer, uint16_t value, uint8_t digits)
+{
+    for (int8_t i = digits - 1; i >= 0; i--)
+    {
+        buffer[i] = '0' + value%10;
+        value /= 10;
+    }
+    return buffer + digits;
+}
+
+
+// These write the ISO8601 formatted string into a buffer
+void Logger::formatDateTime_ISO8601(DateTime& dt, char *buffer)
+{
+    char *c = buffer;
+    c = writeDigits(c, dt.year(), 4);
+    *c++ = '-';
+    c = writeDigits(c, dt.month(), 2);
+    *c++ = '-';
+    c = writeDigits(c, dt.date(), 2);
+    *c++ = 'T';
+    c = writeDigits(c, dt.hour(), 2);
+    *c++ = ':';
+    c = writeDigits(c, dt.minute(), 2);
+    *c++ = ':';
+    c = writeDigits(c, dt.second(), 2);
+    strcpy(c, _timeZoneSuffix);
+}
+void Logger::formatDateTime_ISO8601(uint32_t epochTime, char *buffer)
+{
+    DateTime dt = dtFromEpoch(epochTime);
+    formatDateTime_ISO8601(dt, buffer);
+}
+
+
+// This returns the ISO8601 formatted string for an epoch time, formatting it
+// only if it's a different time than last time
+const char *Logger::getISO8601Time(uint32_t epochTime)
+{
+    if (_iso8601Cache[0] == '\0' || epochTime != _iso8601CacheTime)
+    {
+        formatDateTime_ISO8601(epochTime, _iso8601Cache);
+        _iso8601CacheTime = epochTime;
+    }
+    return _iso8601Cache;
+}
+
+
 // This sets the real time clock to the given time
 bool Logger::setRTClock(uint32_t UTCEpochSeconds)
 {
@@ -609,6 +858,50 @@ bool Logger::setRTClock(uint32_t UTCEpochSeconds)
 }
 
 
+// This gives the time to the clock discipline, if there is one
+bool Logger::disciplineRTClock(uint32_t UTCEpochSeconds)
+{
+    if (_clockDiscipline == NULL) return setRTClock(UTCEpochSeconds);
+
+    uint32_t clockUTC = getNowEpoch() - ((uint32_t)getLoggerTimeZone())*3600;
+    if (!_clockDiscipline->addTimeSample(UTCEpochSeconds, clockUTC))
+    {
+        PRINTOUT(F("Bad timestamp, not using it for the clock."));
+        return false;
+    }
+
+    // Smaller errors are stepped out at sleep, between intervals.  An error of
+    // a whole interval or more means the clock was never really set, so there
+    // are no interval times to protect.
+    int32_t step = _clockDiscipline->getPendingStep();
+    if ((uint32_t)abs(step) >= _loggingIntervalSeconds)
+    {
+        _clockDiscipline->takeStep(step);
+        stepRTClock(step);
+        PRINTOUT(F("Clock set!"));
+    }
+    return true;
+}
+
+
+// This adds the given seconds to the real time clock, in its own time zone
+// Setting the DS3231 restarts its count of the current second, which would
+// lose whatever part of it had passed, so the clock is set just as a new
+// second starts.  That keeps each step a whole number of seconds, as the
+// clock discipline counts it.
+void Logger::stepRTClock(int32_t step)
+{
+    uint32_t startSecond = getNowEpoch();
+    uint32_t nowSecond = startSecond;
+    uint32_t startMillis = millis();
+    while (nowSecond == startSecond && millis() - startMillis < 1100L)
+    {
+        nowSecond = getNowEpoch();
+    }
+    setNowEpoch(nowSecond - ((uint32_t)_loggerRTCOffset)*3600 + step);
+}
+
+
 // This sets static variables for the date/time - this is needed so that all
 // data outputs (SD, EnviroDIY, serial printing, etc) print the same time
 // for updating the sensors - even though the routines to update the sensors
@@ -630,21 +923,27 @@ bool Logger::checkInterval(void)
     uint32_t checkTime = getNowEpoch();
     MS_DBG(F("Current Unix Timestamp:"), checkTime, F("->"), \
         formatDateTime_ISO8601(checkTime));
-    MS_DBG(F("Logging interval in seconds:"), (_loggingIntervalMinutes*60));
-    MS_DBG(F("Mod of Logging Interval:"), checkTime % (_loggingIntervalMinutes*60));
+    MS_DBG(F("Logging interval in seconds:"), _loggingIntervalSeconds);
+    MS_DBG(F("Mod of Logging Interval:"), checkTime % _loggingIntervalSeconds);
+
+    // If we slept on an alarm, go by the alarm time, so waking a second late
+    // doesn't skip the interval.  Otherwise, the current time must be on an
+    // interval.
+    uint32_t dueTime = getLastDueTime(checkTime);
+    if (_nextAlarmTime != 0) retval = checkTime >= _nextAlarmTime;
+    else retval = checkTime == dueTime;
 
-    if (checkTime % (_loggingIntervalMinutes*60) == 0)
+    if (retval)
     {
-        // Update the time variables with the current time
-        markTime();
+        // Update the time variables with the time the interval was due
+        Logger::markedEpochTime = dueTime;
+        _nextAlarmTime = 0;
         MS_DBG(F("Time marked at (unix):"), Logger::markedEpochTime);
         MS_DBG(F("Time to log!"));
-        retval = true;
     }
     else
     {
         MS_DBG(F("Not time yet."));
-        retval = false;
     }
     return retval;
 }
@@ -656,11 +955,11 @@ bool Logger::checkMarkedInterval(void)
 {
     bool retval;
     MS_DBG(F("Marked Time:"), Logger::markedEpochTime,
-           F("Logging interval in seconds:"), (_loggingIntervalMinutes*60),
-           F("Mod of Logging Interval:"), Logger::markedEpochTime % (_loggingIntervalMinutes*60));
+           F("Logging interval in seconds:"), _loggingIntervalSeconds,
+           F("Mod of Logging Interval:"), Logger::markedEpochTime % _loggingIntervalSeconds);
 
     if (Logger::markedEpochTime != 0 &&
-        (Logger::markedEpochTime % (_loggingIntervalMinutes*60) == 0))
+        getLastDueTime(Logger::markedEpochTime) == Logger::markedEpochTime)
     {
         MS_DBG(F("Time to log!"));
         retval = true;
@@ -674,6 +973,98 @@ bool Logger::checkMarkedInterval(void)
 }
 
 
+// This returns the next time after the given time that the logger is due
+uint32_t Logger::getNextDueTime(uint32_t epochTime)
+{
+    uint32_t nextDue = (epochTime/_loggingIntervalSeconds + 1)*_loggingIntervalSeconds;
+    if (isBursting(epochTime))
+    {
+        uint32_t nextBurst = (epochTime/_burstIntervalSeconds + 1)*_burstIntervalSeconds;
+        if (nextBurst < nextDue && isBursting(nextBurst)) nextDue = nextBurst;
+    }
+    return nextDue;
+}
+
+
+// This returns the last time at or before the given time that the logger was due
+uint32_t Logger::getLastDueTime(uint32_t epochTime)
+{
+    uint32_t lastDue = epochTime - epochTime % _loggingIntervalSeconds;
+    if (isBursting(epochTime))
+    {
+        uint32_t lastBurst = epochTime - epochTime % _burstIntervalSeconds;
+        if (lastBurst > lastDue) lastDue = lastBurst;
+    }
+    return lastDue;
+}
+
+
+// ===================================================================== //
+// Public functions for triggered burst logging
+// ===================================================================== //
+
+// Sets the burst interval and how long a burst goes on
+void Logger::setBurstMode(uint16_t burstIntervalSeconds, uint16_t burstDurationMinutes)
+{
+    _burstIntervalSeconds = burstIntervalSeconds;
+    _burstDurationMinutes = burstDurationMinutes;
+}
+
+
+// Adds a trigger to start a burst
+bool Logger::addTrigger(LoggerTrigger& trigger)
+{
+    for (uint8_t i = 0; i < MAX_NUMBER_TRIGGERS; i++)
+    {
+        if (_triggers[i] == NULL)
+        {
+            _triggers[i] = &trigger;
+            return true;
+        }
+    }
+    MS_DBG(F("No room for another trigger!"));
+    return false;
+}
+
+
+// This checks all of the triggers against the latest values
+bool Logger::checkTriggers(void)
+{
+    if (_burstIntervalSeconds == 0) return false;
+
+    bool fired = false;
+    for (uint8_t i = 0; i < MAX_NUMBER_TRIGGERS; i++)
+    {
+        // Check every trigger, so each keeps its last value for its rate
+        if (_triggers[i] != NULL && _triggers[i]->check(Logger::markedEpochTime))
+            fired = true;
+    }
+
+    if (fired)
+    {
+        if (!isBursting(Logger::markedEpochTime))
+        {
+            PRINTOUT(F("Starting burst logging every"), _burstIntervalSeconds,
+                     F("seconds"));
+        }
+        _burstEndTime = Logger::markedEpochTime + (uint32_t)_burstDurationMinutes*60;
+    }
+    else if (_burstEndTime != 0 && !isBursting(Logger::markedEpochTime))
+    {
+        PRINTOUT(F("Burst logging finished"));
+        _burstEndTime = 0;
+    }
+    return isBursting(Logger::markedEpochTime);
+}
+
+
+// This checks if a burst is going on at a time
+bool Logger::isBursting(uint32_t epochTime)
+{
+    return _burstIntervalSeconds > 0 && epochTime < _burstEndTime;
+}
+
+
 // ============================================================================
 //  Public Functions for sleeping the logger
 // ============================================================================
@@ -684,6 +1075,7 @@ bool Logger::checkMarkedInterval(void)
 void Logger::wakeISR(void)
 {
     // MS_DBG(F("\nClock interrupt!"));
+    Logger::_clockWake = true;
 }
 
 
@@ -698,16 +1090,36 @@ void Logger::systemSleep(void)
         return;
     }
 
+    // Only the clock's alarm (or the testing button) should wake us fully
+    Logger::_clockWake = false;
+
+    // This interval is done, so take off as much of the clock's error as can
+    // be without it crossing an interval time
+    if (_clockDiscipline != NULL && _clockDiscipline->getPendingStep() != 0)
+    {
+        uint32_t now = getNowEpoch();
+        int32_t step = _clockDiscipline->takeSafeStep(now, getLastDueTime(now),
+                                                      getNextDueTime(now));
+        if (step != 0)
+        {
+            stepRTClock(step);
+            MS_DBG(F("Stepped clock by"), step, F("seconds"));
+        }
+    }
+
+    // Set the alarm for the next time the logger is due, in the clock's own
+    // time zone
+    _nextAlarmTime = getNextDueTime(getNowEpoch());
+    uint32_t alarmRTCTime = _nextAlarmTime - ((uint32_t)_loggerRTCOffset)*3600;
+
     #if defined MS_SAMD_DS3231 || not defined ARDUINO_ARCH_SAMD
 
-    // Unfortunately, because of the way the alarm on the DS3231 is set up, it
-    // cannot interrupt on any frequencies other than every second, minute,
-    // hour, day, or date.  We could set it to alarm hourly every 5 minutes past
-    // the hour, but not every 5 minutes.  This is why we set the alarm for
-    // every minute and use the checkInterval function.  This is a hardware
-    // limitation of the DS3231; it is not due to the libraries or software.
-    MS_DBG(F("Setting alarm on DS3231 RTC for every minute."));
-    rtc.enableInterrupts(EveryMinute);
+    // The DS3231 alarm can match a time of day down to the second.  An
+    // interval longer than a day wakes the processor a day early, when it
+    // checks the interval and goes back to sleep.
+    DateTime alarmDT(alarmRTCTime - EPOCH_TIME_OFF);
+    MS_DBG(F("Setting alarm on DS3231 RTC for"), formatDateTime_ISO8601(_nextAlarmTime));
+    rtc.enableInterrupts(alarmDT.hour(), alarmDT.minute(), alarmDT.second());
 
     // Clear the last interrupt flag in the RTC status register
     // The next timed interrupt will not be sent until this is cleared
@@ -723,18 +1135,22 @@ void Logger::systemSleep(void)
     NVIC_EnableIRQ(RTC_IRQn);  // enable RTC interrupt
     NVIC_SetPriority(RTC_IRQn, 0);  // highest priority
 
-    // Alarms on the RTC built into the SAMD21 appear to be identical to those
-    // in the DS3231.  See more notes below.
-    // We're setting the alarm seconds to 59 and then seting it to go off
-    // whenever the seconds match the 59.  I'm using 59 instead of 00
-    // because there seems to be a bit of a wake-up delay
-    MS_DBG(F("Setting alarm on SAMD built-in RTC for every minute."));
+    // Set the alarm to match the full date and time of the next interval
+    MS_DBG(F("Setting alarm on SAMD built-in RTC for"), formatDateTime_ISO8601(_nextAlarmTime));
     zero_sleep_rtc.attachInterrupt(wakeISR);
-    zero_sleep_rtc.setAlarmSeconds(59);
-    zero_sleep_rtc.enableAlarm(zero_sleep_rtc.MATCH_SS);
+    zero_sleep_rtc.setAlarmEpoch(alarmRTCTime);
+    zero_sleep_rtc.enableAlarm(zero_sleep_rtc.MATCH_YYMMDDHHMMSS);
 
     #endif
 
+    // If the alarm time came while it was being set, the alarm won't go off
+    // until the same time tomorrow, so don't sleep
+    if (getNowEpoch() >= _nextAlarmTime)
+    {
+        MS_DBG(F("Next interval is already here; not sleeping."));
+        return;
+    }
+
     // Send one last message before shutting down serial ports
     MS_DBG(F("Putting processor to sleep.  ZZzzz..."));
 
@@ -786,8 +1202,25 @@ void Logger::systemSleep(void)
 	SysTick->CTRL &= ~SysTick_CTRL_TICKINT_Msk;
     // Now go to sleep
 	SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
-	__DSB();
-    __WFI();
+
+    // Sleep until the clock or the testing button wakes us.  The check is made
+    // with interrupts off, so an alarm that came while getting ready to sleep
+    // isn't slept through and one can't slip in just before the WFI; a waiting
+    // interrupt still ends the WFI and runs once they're back on.  If some
+    // other interrupt woke us, go right back to sleep.
+    bool wasWoken = false;
+    __disable_irq();
+    while (!Logger::_clockWake && !Logger::startTesting)
+    {
+        if (wasWoken) _quickWakeCount++;
+        __DSB();
+        __WFI();
+        // Let the waking interrupt run
+        __enable_irq();
+        __disable_irq();
+        wasWoken = true;
+    }
+    __enable_irq();
 
     #elif defined ARDUINO_ARCH_AVR
 
@@ -830,13 +1263,25 @@ void Logger::systemSleep(void)
     // Set the sleep enable bit.
     sleep_enable();
 
-    // Re-enables interrupts so we can wake up again
+    // Sleep until the clock or the testing button wakes us.  The check is made
+    // with interrupts off, so an alarm that came while getting ready to sleep
+    // isn't slept through and one can't slip in just before the sleep; the
+    // instruction after the sei in interrupts() always runs before any waiting
+    // interrupt, so sleep_cpu() can't miss it.  If some other interrupt woke
+    // us, go right back to sleep.
+    bool wasWoken = false;
+    while (!Logger::_clockWake && !Logger::startTesting)
+    {
+        if (wasWoken) _quickWakeCount++;
+        // Re-enable interrupts so we can wake up again, then actually put the
+        // processor into sleep mode.  This must happen after the SE bit is set.
+        interrupts();
+        sleep_cpu();
+        noInterrupts();
+        wasWoken = true;
+    }
     interrupts();
 
-    // Actually put the processor into sleep mode.
-    // This must happen after the SE bit is set.
-    sleep_cpu();
-
     #endif
     // ---------------------------------------------------------------------
 
@@ -1015,10 +1460,13 @@ void Logger::printFileHeader(Stream *stream)
 // time -  out over an Arduino stream
 void Logger::printSensorDataCSV(Stream *stream)
 {
-    String csvString = "";
-    dtFromEpoch(Logger::markedEpochTime).addToString(csvString);
-    csvString += ',';
-    stream->print(csvString);
+    // The CSV time is the ISO8601 time with a space for the "T" and without
+    // the time zone
+    const char *isoTime = getISO8601Time(getRecordEpochTime());
+    stream->write(isoTime, 10);
+    stream->print(' ');
+    stream->write(isoTime + 11, 8);
+    stream->print(',');
     for (uint8_t i = 0; i < getArrayVarCount(); i++)
     {
         stream->print(getValueStringAtI(i));
@@ -1305,6 +1753,12 @@ void Logger::testingMode()
     PRINTOUT(F("Entering sensor testing mode"));
     delay(100);  // This seems to prevent crashes, no clue why ....
 
+    // Report the wakes that didn't need the logger
+    if (_quickWakeCount > 0)
+    {
+        PRINTOUT(_quickWakeCount, F("wake[s] went straight back to sleep"));
+    }
+
     // Power up the modem
     if (_logModem != NULL) _logModem->modemPowerUp();
 
@@ -1323,12 +1777,16 @@ void Logger::testingMode()
         // NOTE:  NOT using complete update because we want everything left
         // on between iterations in testing mode.
         _internalArray->updateAllSensors();
+        // Print the live values.  Testing readings aren't saved to the record
+        // buffer, where they'd push out logged records not yet published.
+        selectLiveValues();
         // Print out the current logger time
         PRINTOUT(F("Current logger time is"), formatDateTime_ISO8601(getNowEpoch()));
         PRINTOUT(F("-----------------------"));
         // Print out the sensor data
         #if defined(STANDARD_SERIAL_OUTPUT)
             _internalArray->printSensorData(&STANDARD_SERIAL_OUTPUT);
+            _internalArray->printSensorTelemetry(&STANDARD_SERIAL_OUTPUT);
         #endif
         PRINTOUT(F("-----------------------"));
         watchDogTimer.resetWatchDog();
@@ -1378,10 +1836,10 @@ void Logger::begin()
 {
     MS_DBG(F("Logger ID is:"), _loggerID);
     MS_DBG(F("Logger is set to record at"),
-           _loggingIntervalMinutes, F("minute intervals."));
+           _loggingIntervalSeconds, F("second intervals."));
 
     MS_DBG(F("Setting up a watch-dog timer to fire after 5 minutes of inactivity"));
-    // watchDogTimer.setupWatchDog(((uint32_t)_loggingIntervalMinutes)*60*3);
+    // watchDogTimer.setupWatchDog(_loggingIntervalSeconds*3);
     watchDogTimer.setupWatchDog((uint32_t)(5*60*3));
     // Enable the watchdog
     watchDogTimer.enableWatchDog();
@@ -1505,9 +1963,14 @@ void Logger::logData(void)
         // Do a complete sensor update
         MS_DBG(F("    Running a complete sensor update..."));
         watchDogTimer.resetWatchDog();
-        _internalArray->completeUpdate();
+        _internalArray->completeUpdate(Logger::markedEpochTime);
         watchDogTimer.resetWatchDog();
 
+        // Keep a copy of the record in the buffer, if there is one
+        saveRecord();
+        // Start or extend a burst if the new values call for one
+        checkTriggers();
+
         // Create a csv data record and save it to the log file
         logToSD();
         // Cut power from the SD card, waiting for housekeeping
@@ -1552,8 +2015,20 @@ void Logger::logDataAndPublish(void)
         // and writing to it.  Could we turn it on just before writing?
         turnOnSDcard(false);
 
+        // Check if any publishers are due, counting the record about to be
+        // saved, and if it's time for the clock sync at noon.  With a clock
+        // discipline, the sync is only due once the clock may have drifted.
+        bool publishDue = checkPublishersDue(_recordBuffer != NULL ? 1 : 0);
+        bool syncDue = Logger::markedEpochTime != 0 &&
+                       Logger::markedEpochTime % 86400 == 43200 &&
+                       (_clockDiscipline == NULL ||
+                        _clockDiscipline->isSyncDue(Logger::markedEpochTime -
+                            ((uint32_t)getLoggerTimeZone())*3600));
+        // Only bring up the modem if it's needed
+        bool modemNeeded = _logModem != NULL && (publishDue || syncDue);
+
         // Turn on the modem to let it start searching for the network
-        if (_logModem != NULL) _logModem->modemPowerUp();
+        if (modemNeeded) _logModem->modemPowerUp();
 
         // Do a complete update on the variable array.
         // This this includes powering all of the sensors, getting updated
@@ -1562,28 +2037,33 @@ void Logger::logDataAndPublish(void)
         // to run if the sensor was not previously set up.
         MS_DBG(F("Running a complete sensor update..."));
         watchDogTimer.resetWatchDog();
-        _internalArray->completeUpdate();
+        _internalArray->completeUpdate(Logger::markedEpochTime);
         watchDogTimer.resetWatchDog();
 
+        // Keep a copy of the record in the buffer, if there is one
+        saveRecord();
+        // Start or extend a burst if the new values call for one
+        checkTriggers();
+
         // Create a csv data record and save it to the log file
         logToSD();
 
-        if (_logModem != NULL)
+        if (modemNeeded)
         {
             // Connect to the network
             MS_DBG(F("Connecting to the Internet..."));
             if (_logModem->connectInternet())
             {
-                // Publish data to remotes
+                // Publish data to all of the due remotes in this one session
                 watchDogTimer.resetWatchDog();
-                publishDataToRemotes();
+                if (publishDue) publishDataToRemotes();
                 watchDogTimer.resetWatchDog();
 
-                if (Logger::markedEpochTime != 0 && Logger::markedEpochTime % 86400 == 43200)
+                if (syncDue)
                 // Sync the clock at noon
                 {
-                    MS_DBG(F("Running a daily clock sync..."));
-                    setRTClock(_logModem->getNISTTime());
+                    MS_DBG(F("Running a clock sync..."));
+                    disciplineRTClock(_logModem->getNISTTime());
                     watchDogTimer.resetWatchDog();
                 }
 
@@ -23,6 +23,9 @@
 #include "ModSensorDebugger.h"
 #undef MS_DEBUGGING_STD
 #include "VariableArray.h"
+#include "LoggerRecordBuffer.h"
+#include "LoggerTrigger.h"
+#include "ClockDiscipline.h"
 #include "LoggerModem.h"
 
 // Bring in the libraries to handle the processor sleep/standby modes
@@ -49,6 +52,12 @@
 
 // The largest number of variables from a single sensor
 #define MAX_NUMBER_SENDERS 4
+// The largest number of triggers for burst logging
+#define MAX_NUMBER_TRIGGERS 4
+
+// The length of the longest ISO8601 date-time string, with its time zone and
+// the terminating null: "2018-01-01T00:00:00-05:00"
+#define ISO8601_BUFFER_SIZE 26
 
 
 class dataPublisher;  // Forward declaration
@@ -80,7 +89,12 @@ public:
 
     // Sets/Gets the logging interval
     void setLoggingInterval(uint16_t loggingIntervalMinutes);
-    uint16_t getLoggingInterval(){return _loggingIntervalMinutes;}
+    // NOTE:  This returns 0 for an interval shorter than a minute
+    uint16_t getLoggingInterval(){return _loggingIntervalSeconds/60;}
+    // Sets/Gets the logging interval in seconds, for intervals shorter than a
+    // minute or not a whole number of minutes
+    void setLoggingIntervalSeconds(uint32_t loggingIntervalSeconds);
+    uint32_t getLoggingIntervalSeconds(){return _loggingIntervalSeconds;}
 
     // Sets/Gets the sampling feature UUID
     void setSamplingFeatureUUID(const char *samplingFeatureUUID);
@@ -119,7 +133,7 @@ public:
 protected:
     // Initialization variables
     const char *_loggerID;
-    uint16_t _loggingIntervalMinutes;
+    uint32_t _loggingIntervalSeconds;
     int8_t _SDCardSSPin;
     int8_t _SDCardPowerPin;
     int8_t _mcuWakePin;
@@ -151,14 +165,43 @@ public:
     String getVarCodeAtI(uint8_t position_i);
     // This returns the variable UUID, if one has been assigned
     String getVarUUIDAtI(uint8_t position_i);
-    // This returns the current value of the variable as a string with the
-    // correct number of significant figures
+    // This returns the value of the variable in the selected record, or its
+    // current value if no record is selected, as a string with the correct
+    // number of significant figures
     String getValueStringAtI(uint8_t position_i);
 
 protected:
     // A pointer to the internal variable array instance
     VariableArray *_internalArray;
 
+    // ===================================================================== //
+    // Public functions for the buffer of recent records
+    // ===================================================================== //
+
+public:
+    // Attaches a buffer to keep the most recent records in
+    // See LoggerRecordBuffer.h.
+    void setRecordBuffer(LoggerRecordBuffer& buffer);
+    LoggerRecordBuffer *getRecordBuffer(void){return _recordBuffer;}
+
+    // This copies the latest values of all of the variables into a new record
+    // in the buffer, stamped with the marked time, and selects it.  Returns
+    // the sequence number of the record; 0 if there is no buffer.
+    uint32_t saveRecord(uint8_t flags = 0);
+    // This selects a record in the buffer for the SD card, publishers, etc to
+    // print.  Returns false if the record is no longer in the buffer.
+    bool selectRecord(uint32_t sequence);
+    // This goes back to printing the latest values of the variables
+    void selectLiveValues(void){_recordSelected = false;}
+    // This returns the time of the selected record, or the marked time if
+    // no record is selected
+    uint32_t getRecordEpochTime(void);
+
+protected:
+    LoggerRecordBuffer *_recordBuffer;
+    bool _recordSelected;
+    uint32_t _selectedRecord;
+
     // ===================================================================== //
     // Public functions for internet and dataPublishers
     // ===================================================================== //
@@ -169,11 +212,24 @@ public:
     void attachModem(loggerModem& modem);
 
     // Takes advantage of the modem to synchronize the clock
+    // With a clock discipline attached, the time is given to it instead of
+    // setting the clock directly.
     bool syncRTC();
 
+    // Attaches a clock discipline, to keep the clock on time between syncs
+    // and only sync as often as needed.  See ClockDiscipline.h.
+    void setClockDiscipline(ClockDiscipline& discipline){_clockDiscipline = &discipline;}
+    ClockDiscipline *getClockDiscipline(void){return _clockDiscipline;}
+
     // These tie the variables to their parent sensor
     void registerDataPublisher(dataPublisher* publisher);
-    // Notifies attached variables of new values
+    // This checks which publishers are due to send at the marked time and
+    // returns true if any are.  The modem only needs to be powered if one is.
+    // pendingRecords are records about to be saved to the record buffer.
+    bool checkPublishersDue(uint8_t pendingRecords = 0);
+    // This sends data to all of the publishers that are due, over a single
+    // connection.  With a record buffer, each publisher is sent all of the
+    // records it has not yet sent.
     void publishDataToRemotes(void);
     // These are duplicates of the above functions for backwards compatibility
     void sendDataToRemotes(void);
@@ -187,6 +243,11 @@ protected:
 
     // An array of all of the attached data publishers
     dataPublisher *dataPublishers[MAX_NUMBER_SENDERS];
+    // Which publishers are due (one bit each) and the marked time checked
+    uint8_t _publishersDue;
+    uint32_t _publishersDueTime;
+    // This sends all of the unsent records in the buffer to a publisher
+    void publishBufferedRecords(dataPublisher *publisher);
 
     // ===================================================================== //
     // Public functions to access the clock in proper format and time zone
@@ -233,8 +294,22 @@ public:
     // the LOGGER's offset as the time zone offset in the string.
     static String formatDateTime_ISO8601(uint32_t epochTime);
 
+    // These do the same, writing into a buffer of at least ISO8601_BUFFER_SIZE
+    // characters instead of creating a String
+    static void formatDateTime_ISO8601(DateTime& dt, char *buffer);
+    static void formatDateTime_ISO8601(uint32_t epochTime, char *buffer);
+
+    // This returns the ISO8601 formatted string for an epoch time from a
+    // buffer shared by everything that prints out a record, so the time of a
+    // record is only formatted once.  The buffer is overwritten when this is
+    // next called with a different time.
+    static const char *getISO8601Time(uint32_t epochTime);
+
     // This sets the real time clock to the given time
     bool setRTClock(uint32_t UTCEpochSeconds);
+    // This gives the time to the clock discipline, if there is one, or sets
+    // the clock to it if not.  Returns false if the time was rejected.
+    bool disciplineRTClock(uint32_t UTCEpochSeconds);
 
     // This sets static variables for the date/time - this is needed so that all
     // data outputs (SD, EnviroDIY, serial printing, etc) print the same time
@@ -246,15 +321,55 @@ public:
     static void markTime(void);
 
     // This checks to see if the CURRENT time is an even interval of the logging rate
+    // If the processor was put to sleep with an alarm for the next interval,
+    // this checks if that alarm time has come instead, so a late wake doesn't
+    // miss the interval, and marks the time as the interval time.
     bool checkInterval(void);
 
     // This checks to see if the MARKED time is an even interval of the logging rate
     bool checkMarkedInterval(void);
 
+    // This returns the next time after the given time that the logger is due
+    // to log, at either the logging or the burst interval
+    uint32_t getNextDueTime(uint32_t epochTime);
+    // This returns the last time at or before the given time that the logger
+    // was due to log
+    uint32_t getLastDueTime(uint32_t epochTime);
+
 protected:
     // Static variables - identical for EVERY logger
     static int8_t _loggerTimeZone;
     static int8_t _loggerRTCOffset;
+    // The time zone as it ends an ISO8601 string:  "Z" or "+hh:00"
+    static char _timeZoneSuffix[7];
+    // The last time formatted by getISO8601Time()
+    static char _iso8601Cache[ISO8601_BUFFER_SIZE];
+    static uint32_t _iso8601CacheTime;
+
+    // ===================================================================== //
+    // Public functions for triggered burst logging
+    // ===================================================================== //
+
+public:
+    // Sets the faster interval (in seconds) to log at during a burst, and how
+    // long a burst goes on after the last time a trigger fires.  An interval
+    // of 0 (the default) turns off bursts.
+    void setBurstMode(uint16_t burstIntervalSeconds, uint16_t burstDurationMinutes);
+    // Adds a trigger to start a burst; see LoggerTrigger.h
+    // Returns false if there's no room for another trigger.
+    bool addTrigger(LoggerTrigger& trigger);
+    // This checks all of the triggers against the latest values, starting or
+    // extending a burst if any fire.  Returns true if bursting.
+    // This is run after each record is logged.
+    bool checkTriggers(void);
+    // This checks if a burst is going on at a time
+    bool isBursting(uint32_t epochTime);
+
+protected:
+    LoggerTrigger *_triggers[MAX_NUMBER_TRIGGERS];
+    uint16_t _burstIntervalSeconds;
+    uint16_t _burstDurationMinutes;
+    uint32_t _burstEndTime;
 
     // ============================================================================
     //  Public Functions for sleeping the logger
@@ -262,14 +377,33 @@ protected:
 
 public:
     // Set up the Interrupt Service Request for waking
-    // In this case, we're doing nothing, we just want the processor to wake
+    // In this case, we only note that it was the clock that woke the processor
     // This must be a static function (which means it can only call other static funcions.)
     static void wakeISR(void);
 
-    // Puts the system to sleep to conserve battery life.
+    // Puts the system to sleep to conserve battery life, with the clock set
+    // to wake it at the next time it is due to log.
+    // If any other interrupt wakes the processor, it goes straight back to
+    // sleep without waking up the I2C, serial ports, USB, or watch-dog.
     // This DOES NOT sleep or wake the sensors!!
     void systemSleep(void);
 
+    // The number of times the processor went straight back to sleep
+    // How long each was awake isn't kept; the timers are stopped through the
+    // wake-up and the waking interrupt, which are nearly all of it.
+    static uint32_t getQuickWakeCount(void){return _quickWakeCount;}
+
+protected:
+    // The time the clock alarm was last set for; 0 if not asleep on an alarm
+    uint32_t _nextAlarmTime;
+    ClockDiscipline *_clockDiscipline;
+    // This adds the given seconds to the real time clock
+    void stepRTClock(int32_t step);
+    // Set by the wake ISR
+    static volatile bool _clockWake;
+    static uint32_t _quickWakeCount;
+
+public:
     // A watch-dog to check for lock-ups
     #if defined(ARDUINO_ARCH_SAMD)
     extendedWatchDogSAMD watchDogTimer;
@@ -0,0 +1,134 @@
+/*
+ *LoggerRecordBuffer.cpp
+ *This file is part of the EnviroDIY modular sensors library for Arduino
+ *
+ *Initial library developement done by Sara Damiano (sdamiano@stroudcenter.org).
+ *
+ *This file is for a ring buffer of the most recent records taken by a logger.
+*/
+
+#include "LoggerRecordBuffer.h"
+
+
+LoggerRecordSnapshot::LoggerRecordSnapshot(LoggerRecordBuffer *buffer,
+                                           uint32_t firstSequence,
+                                           uint32_t endSequence)
+{
+    _buffer = buffer;
+    _nextSequence = firstSequence;
+    _endSequence = endSequence;
+    _sequence = firstSequence;
+}
+
+
+bool LoggerRecordSnapshot::next(void)
+{
+    while (_nextSequence != _endSequence)
+    {
+        _sequence = _nextSequence++;
+        // Skip anything overwritten since the snapshot was taken
+        if (_buffer->hasRecord(_sequence)) return true;
+    }
+    return false;
+}
+
+
+uint32_t LoggerRecordSnapshot::getEpochTime(void)
+{
+    return _buffer->getEpochTime(_sequence);
+}
+uint8_t LoggerRecordSnapshot::getFlags(void)
+{
+    return _buffer->getFlags(_sequence);
+}
+float LoggerRecordSnapshot::getValue(uint8_t varNum)
+{
+    return _buffer->getValue(_sequence, varNum);
+}
+
+
+LoggerRecordBuffer::LoggerRecordBuffer(float *values, uint32_t *epochTimes,
+                                       uint8_t *flags, uint8_t maxRecords,
+                                       uint8_t maxVariables)
+{
+    _values = values;
+    _epochTimes = epochTimes;
+    _flags = flags;
+    _maxRecords = maxRecords;
+    _maxVariables = maxVariables;
+    _recordCount = 0;
+    _nextSequence = 0;
+    _droppedCount = 0;
+}
+LoggerRecordBuffer::~LoggerRecordBuffer(){}
+
+
+void LoggerRecordBuffer::clear(void)
+{
+    _recordCount = 0;
+    _droppedCount = 0;
+}
+
+
+uint32_t LoggerRecordBuffer::addRecord(uint32_t epochTime, VariableArray *array,
+                                       uint8_t flags)
+{
+    uint8_t varCount = array->getVariableCount();
+    if (varCount > _maxVariables)
+    {
+        MS_DBG(F("Only the first"), _maxVariables, F("of"), varCount,
+               F("variables fit in a record!"));
+        varCount = _maxVariables;
+    }
+
+    uint32_t sequence = _nextSequence++;
+    uint8_t slot = getSlot(sequence);
+    if (_recordCount == _maxRecords)
+    {
+        MS_DBG(F("Overwriting record"), sequence - _maxRecords);
+        _droppedCount++;
+    }
+    else _recordCount++;
+
+    float *recordValues = &_values[(uint16_t)slot * _maxVariables];
+    for (uint8_t i = 0; i < _maxVariables; i++)
+    {
+        recordValues[i] = (i < varCount) ? array->getValue(i) : -9999;
+    }
+    _epochTimes[slot] = epochTime;
+    _flags[slot] = flags;
+
+    MS_DBG(F("Stored record"), sequence, F("with"), _recordCount,
+           F("records in the buffer"));
+    return sequence;
+}
+
+
+bool LoggerRecordBuffer::hasRecord(uint32_t sequence)
+{
+    // Unsigned math, so this is also false for sequences not yet given out
+    return (_nextSequence - 1 - sequence) < _recordCount;
+}
+
+
+float LoggerRecordBuffer::getValue(uint32_t sequence, uint8_t varNum)
+{
+    if (varNum >= _maxVariables) return -9999;
+    return _values[(uint16_t)getSlot(sequence) * _maxVariables + varNum];
+}
+
+
+uint8_t LoggerRecordBuffer::getRecordCountFrom(uint32_t sequence)
+{
+    // Only count from the sequence if it's within the buffer
+    if (sequence - getFirstSequence() <= _recordCount)
+        return _nextSequence - sequence;
+    return _recordCount;
+}
+
+
+LoggerRecordSnapshot LoggerRecordBuffer::snapshot(uint32_t fromSequence)
+{
+    return LoggerRecordSnapshot(this, _nextSequence - getRecordCountFrom(fromSequence),
+                                _nextSequence);
+}
@@ -0,0 +1,155 @@
+/*
+ *LoggerRecordBuffer.h
+ *This file is part of the EnviroDIY modular sensors library for Arduino
+ *
+ *Initial library developement done by Sara Damiano (sdamiano@stroudcenter.org).
+ *
+ *This file is for a ring buffer of the most recent records taken by a logger.
+ *
+ *Without a buffer, the only copy of a record is in the variables themselves,
+ *which are overwritten by the next update, so everything that writes out a
+ *record has to do it right away.  With a buffer attached to the logger, each
+ *record is copied in, with its timestamp, once the sensors have been updated.
+ *The SD card writer and the publishers then read the record from the buffer,
+ *so records can be batched or sent later without re-reading them from the SD
+ *card.  Testing mode prints the live values and leaves the buffer alone.
+ *
+ *Every record is given a sequence number, counting up from 0, which stays with
+ *it for as long as it's in the buffer.  Once the buffer is full, the oldest
+ *record is overwritten by the next one.  A snapshot of the buffer remembers the
+ *range of sequence numbers present when it was taken and can be stepped
+ *through oldest to newest, skipping any records that are overwritten while it
+ *is being read.
+*/
+
+// Header Guards
+#ifndef LoggerRecordBuffer_h
+#define LoggerRecordBuffer_h
+
+// Debugging Statement
+// #define MS_LOGGERRECORDBUFFER_DEBUG
+
+#ifdef MS_LOGGERRECORDBUFFER_DEBUG
+#define MS_DEBUGGING_STD "LoggerRecordBuffer"
+#endif
+
+// Included Dependencies
+#include "ModSensorDebugger.h"
+#undef MS_DEBUGGING_STD
+#include "VariableArray.h"
+
+// The flags for a record
+#define LOGGER_RECORD_TESTING 0x01  // A test record, never to be published
+
+
+class LoggerRecordBuffer;  // Forward declaration
+
+
+// A snapshot of the records in a buffer, to step through oldest to newest
+// Call next() before reading each record, ie:
+//   LoggerRecordSnapshot records = buffer.snapshot();
+//   while (records.next()) { ... records.getValue(i) ... }
+class LoggerRecordSnapshot
+{
+public:
+    LoggerRecordSnapshot(LoggerRecordBuffer *buffer,
+                         uint32_t firstSequence, uint32_t endSequence);
+
+    // This moves to the next record that is still in the buffer.  Returns
+    // false once there are no more.
+    bool next(void);
+    // The number of records in the snapshot not yet stepped through
+    uint32_t getRemaining(void){return _endSequence - _nextSequence;}
+
+    // These read the current record
+    uint32_t getSequence(void){return _sequence;}
+    uint32_t getEpochTime(void);
+    uint8_t getFlags(void);
+    float getValue(uint8_t varNum);
+
+protected:
+    LoggerRecordBuffer *_buffer;
+    uint32_t _nextSequence;
+    uint32_t _endSequence;
+    uint32_t _sequence;
+};
+
+
+// The buffer itself, using space given to it
+// Use the LoggerRecordRing template below to create one with its own space.
+class LoggerRecordBuffer
+{
+public:
+    LoggerRecordBuffer(float *values, uint32_t *epochTimes, uint8_t *flags,
+                       uint8_t maxRecords, uint8_t maxVariables);
+    ~LoggerRecordBuffer();
+
+    uint8_t getCapacity(void){return _maxRecords;}
+    uint8_t getMaxVariables(void){return _maxVariables;}
+    uint8_t getRecordCount(void){return _recordCount;}
+    bool isFull(void){return _recordCount == _maxRecords;}
+    // The number of records overwritten before being cleared
+    uint32_t getDroppedCount(void){return _droppedCount;}
+
+    // This removes all of the records
+    // The sequence numbers keep counting up.
+    void clear(void);
+
+    // This copies the latest values of all of the variables in the array into
+    // a new record, overwriting the oldest record if the buffer is full.
+    // Returns the sequence number of the new record.
+    uint32_t addRecord(uint32_t epochTime, VariableArray *array, uint8_t flags = 0);
+
+    // The sequence number of the oldest record in the buffer and the one the
+    // next record will be given
+    uint32_t getFirstSequence(void){return _nextSequence - _recordCount;}
+    uint32_t getNextSequence(void){return _nextSequence;}
+    // This checks if a record is still in the buffer
+    bool hasRecord(uint32_t sequence);
+    // The number of records in the buffer from the given sequence number to
+    // the newest.  All of them if the sequence number is older than the
+    // buffer.
+    uint8_t getRecordCountFrom(uint32_t sequence);
+
+    // These read a record by its sequence number
+    // Check hasRecord() first; these don't.
+    uint32_t getEpochTime(uint32_t sequence){return _epochTimes[getSlot(sequence)];}
+    uint8_t getFlags(uint32_t sequence){return _flags[getSlot(sequence)];}
+    float getValue(uint32_t sequence, uint8_t varNum);
+
+    // This takes a snapshot of the records from the given sequence number to
+    // the newest.  By default, all of the records in the buffer.
+    LoggerRecordSnapshot snapshot(uint32_t fromSequence = 0);
+
+protected:
+    uint8_t getSlot(uint32_t sequence){return sequence % _maxRecords;}
+
+    float *_values;
+    uint32_t *_epochTimes;
+    uint8_t *_flags;
+    uint8_t _maxRecords;
+    uint8_t _maxVariables;
+
+    uint8_t _recordCount;
+    uint32_t _nextSequence;
+    uint32_t _droppedCount;
+};
+
+
+// A buffer with space for MAX_RECORDS records of up to MAX_VARIABLES values
+// NOTE:  This takes (4 x MAX_VARIABLES + 5) x MAX_RECORDS bytes of RAM.
+template <uint8_t MAX_RECORDS, uint8_t MAX_VARIABLES>
+class LoggerRecordRing : public LoggerRecordBuffer
+{
+public:
+    LoggerRecordRing()
+      : LoggerRecordBuffer(_valueBuffer, _timeBuffer, _flagBuffer,
+                           MAX_RECORDS, MAX_VARIABLES) {}
+
+private:
+    float _valueBuffer[MAX_RECORDS * MAX_VARIABLES];
+    uint32_t _timeBuffer[MAX_RECORDS];
+    uint8_t _flagBuffer[MAX_RECORDS];
+};
+
+#endif  // Header Guard
@@ -0,0 +1,65 @@
+/*
+ *LoggerTrigger.cpp
+ *This file is part of the EnviroDIY modular sensors library for Arduino
+ *
+ *Initial library developement done by Sara Damiano (sdamiano@stroudcenter.org).
+ *
+ *This file is for the triggers that switch a logger into burst mode.
+*/
+
+#include "LoggerTrigger.h"
+
+
+LoggerTrigger::LoggerTrigger(Variable *variable, triggerRule rule, float threshold)
+{
+    _variable = variable;
+    _rule = rule;
+    _threshold = threshold;
+    reset();
+}
+LoggerTrigger::~LoggerTrigger(){}
+
+
+void LoggerTrigger::reset(void)
+{
+    _lastValue = -9999;
+    _lastTime = 0;
+}
+
+
+bool LoggerTrigger::check(uint32_t epochTime)
+{
+    return checkValue(_variable->getValue(), epochTime);
+}
+
+
+bool LoggerTrigger::checkValue(float value, uint32_t epochTime)
+{
+    if (value == -9999) return false;
+
+    bool fired = false;
+    switch (_rule)
+    {
+        case TRIGGER_ABOVE: fired = value > _threshold; break;
+        case TRIGGER_BELOW: fired = value < _threshold; break;
+        case TRIGGER_RISING:
+        case TRIGGER_FALLING:
+        {
+            // Need a previous value from an earlier time for a rate
+            if (_lastValue != -9999 && epochTime > _lastTime)
+            {
+                float ratePerMinute = (value - _lastValue)*60/(epochTime - _lastTime);
+                if (_rule == TRIGGER_RISING) fired = ratePerMinute > _threshold;
+                else fired = -ratePerMinute > _threshold;
+                MS_DBG(_variable->getVarCode(), F("changing at"), ratePerMinute,
+                       F("per minute"));
+            }
+            break;
+        }
+    }
+    _lastValue = value;
+    _lastTime = epochTime;
+
+    if (fired) MS_DBG(F("Trigger on"), _variable->getVarCode(), F("fired at"), value);
+    return fired;
+}
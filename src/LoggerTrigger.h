@@ -0,0 +1,72 @@
+/*
+ *LoggerTrigger.h
+ *This file is part of the EnviroDIY modular sensors library for Arduino
+ *
+ *Initial library developement done by Sara Damiano (sdamiano@stroudcenter.org).
+ *
+ *This file is for the triggers that switch a logger into burst mode.
+ *
+ *A trigger watches a single variable and is checked after each record.  It
+ *fires when the variable is above or below a threshold, or is rising or falling
+ *faster than a rate (in units per minute) since the last record.  When any
+ *trigger fires, the logger logs at its faster burst interval until the burst
+ *duration has passed with no trigger firing.
+*/
+
+// Header Guards
+#ifndef LoggerTrigger_h
+#define LoggerTrigger_h
+
+// Debugging Statement
+// #define MS_LOGGERTRIGGER_DEBUG
+
+#ifdef MS_LOGGERTRIGGER_DEBUG
+#define MS_DEBUGGING_STD "LoggerTrigger"
+#endif
+
+// Included Dependencies
+#include "ModSensorDebugger.h"
+#undef MS_DEBUGGING_STD
+#include "VariableBase.h"
+
+// The rules a trigger can follow
+typedef enum triggerRule
+{
+    TRIGGER_ABOVE = 0,  // The value is above the threshold
+    TRIGGER_BELOW,  // The value is below the threshold
+    TRIGGER_RISING,  // The value is rising faster than the threshold per minute
+    TRIGGER_FALLING  // The value is falling faster than the threshold per minute
+} triggerRule;
+
+
+class LoggerTrigger
+{
+public:
+    LoggerTrigger(Variable *variable, triggerRule rule, float threshold);
+    ~LoggerTrigger();
+
+    Variable *getVariable(void){return _variable;}
+    triggerRule getRule(void){return _rule;}
+    float getThreshold(void){return _threshold;}
+    void setThreshold(float threshold){_threshold = threshold;}
+
+    // This checks the latest value of the variable against the rule
+    // Values of -9999 never fire the trigger.
+    bool check(uint32_t epochTime);
+    // This checks a value against the rule, as check() does
+    bool checkValue(float value, uint32_t epochTime);
+
+    // This forgets the last value, so the rate is not figured across a gap
+    void reset(void);
+
+protected:
+    Variable *_variable;
+    triggerRule _rule;
+    float _threshold;
+
+    // The last good value and its time, for the rates
+    float _lastValue;
+    uint32_t _lastTime;
+};
+
+#endif  // Header Guard
@@ -0,0 +1,155 @@
+/*
+ *PowerRail.cpp
+ *This file is part of the EnviroDIY modular sensors library for Arduino
+ *
+ *Initial library developement done by Sara Damiano (sdamiano@stroudcenter.org).
+ *
+ *This file is for the power rails that sensors are switched on and off with.
+*/
+
+#include "PowerRail.h"
+
+PowerRail PowerRail::_rails[POWER_RAIL_MAX_RAILS];
+uint8_t PowerRail::_railCount = 0;
+float PowerRail::_currentLimit_mA = 0;
+
+
+PowerRail::PowerRail()
+{
+    _powerPin = -1;
+    _inputRegister = NULL;
+    _bitMask = 0;
+    _holdCount = 0;
+    _millisPowerOn = 0;
+    _powerOnCount = 0;
+    _lastOnTime_ms = 0;
+    _totalOnTime_ms = 0;
+    _inrushCurrent_mA = 0;
+    _steadyCurrent_mA = 0;
+    _inrushTime_ms = POWER_RAIL_DEFAULT_INRUSH_MS;
+}
+
+
+void PowerRail::begin(int8_t powerPin)
+{
+    _powerPin = powerPin;
+    _inputRegister = portInputRegister(digitalPinToPort(powerPin));
+    _bitMask = digitalPinToBitMask(powerPin);
+}
+
+
+PowerRail *PowerRail::getRail(int8_t powerPin)
+{
+    if (powerPin < 0) return NULL;
+    for (uint8_t i = 0; i < _railCount; i++)
+    {
+        if (_rails[i]._powerPin == powerPin) return &_rails[i];
+    }
+    if (_railCount >= POWER_RAIL_MAX_RAILS)
+    {
+        MS_DBG(F("No room for a power rail on pin"), powerPin);
+        return NULL;
+    }
+    MS_DBG(F("Creating power rail for pin"), powerPin);
+    _rails[_railCount].begin(powerPin);
+    return &_rails[_railCount++];
+}
+
+
+uint32_t PowerRail::powerUp(void)
+{
+    if (_holdCount == 0)
+    {
+        if (!isOn())
+        {
+            MS_DBG(F("Switching on power rail on pin"), _powerPin);
+            digitalWrite(_powerPin, HIGH);
+            _millisPowerOn = millis();
+            _powerOnCount++;
+        }
+        // Something else already switched the pin on; the time it came up is
+        // unknown, so count from now
+        else if (_millisPowerOn == 0) _millisPowerOn = millis();
+    }
+    _holdCount++;
+    MS_DBG(_holdCount, F("sensor[s] holding power rail on pin"), _powerPin);
+    return _millisPowerOn;
+}
+
+
+bool PowerRail::powerDown(void)
+{
+    if (_holdCount > 0) _holdCount--;
+    if (_holdCount > 0)
+    {
+        MS_DBG(F("Leaving power rail on pin"), _powerPin, F("on for"),
+               _holdCount, F("more sensor[s]"));
+        return false;
+    }
+
+    MS_DBG(F("Switching off power rail on pin"), _powerPin);
+    digitalWrite(_powerPin, LOW);
+    if (_millisPowerOn != 0)
+    {
+        _lastOnTime_ms = millis() - _millisPowerOn;
+        _totalOnTime_ms += _lastOnTime_ms;
+        MS_DBG(F("Power rail on pin"), _powerPin, F("was on for"), _lastOnTime_ms, F("ms"));
+    }
+    _millisPowerOn = 0;
+    return true;
+}
+
+
+uint32_t PowerRail::getMillisPowerOn(void)
+{
+    // If something else switched the pin, the time can't be trusted
+    if (!isOn()) _millisPowerOn = 0;
+    return _millisPowerOn;
+}
+
+
+void PowerRail::setCurrentDraw(float inrush_mA, float steady_mA, uint32_t inrushTime_ms)
+{
+    _inrushCurrent_mA = inrush_mA;
+    _steadyCurrent_mA = steady_mA;
+    _inrushTime_ms = inrushTime_ms;
+}
+
+
+float PowerRail::getCurrentDraw(uint32_t now)
+{
+    if (_millisPowerOn == 0) return 0;
+    if (now - _millisPowerOn < _inrushTime_ms) return _inrushCurrent_mA;
+    return _steadyCurrent_mA;
+}
+
+
+void PowerRail::setCurrentLimit(float currentLimit_mA)
+{
+    _currentLimit_mA = currentLimit_mA;
+}
+
+
+bool PowerRail::canPowerUp(void)
+{
+    if (_currentLimit_mA <= 0 || _millisPowerOn != 0) return true;
+
+    uint32_t now = millis();
+    float draw = 0;
+    bool inrushPending = false;
+    for (uint8_t i = 0; i < _railCount; i++)
+    {
+        float railDraw = _rails[i].getCurrentDraw(now);
+        if (railDraw > _rails[i]._steadyCurrent_mA) inrushPending = true;
+        draw += railDraw;
+    }
+    if (draw + _inrushCurrent_mA <= _currentLimit_mA) return true;
+
+    if (!inrushPending)
+    {
+        MS_DBG(F("Power rail on pin"), _powerPin, F("will go over the current limit by"),
+               draw + _inrushCurrent_mA - _currentLimit_mA, F("mA"));
+        return true;
+    }
+    return false;
+}
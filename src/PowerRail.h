@@ -0,0 +1,128 @@
+/*
+ *PowerRail.h
+ *This file is part of the EnviroDIY modular sensors library for Arduino
+ *
+ *Initial library developement done by Sara Damiano (sdamiano@stroudcenter.org).
+ *
+ *This file is for the power rails that sensors are switched on and off with.
+ *There is a single rail object for each power pin, shared by every sensor
+ *powered by that pin, so those sensors always agree on whether the power is on.
+ *
+ *The port register and bit mask of the pin are looked up once when the rail is
+ *created, so checking the power is a single register read.
+ *
+ *The rail is reference counted:  each sensor that needs the power holds the
+ *rail, the pin is only switched on by the first sensor to hold it and only
+ *switched off once the last sensor lets go.  The rail keeps the time it came
+ *up, so a sensor that joins a rail that's already on picks up the warm-up time
+ *that has already passed, and how long it has been on in total.
+ *
+ *To keep the board from browning out when many sensors switch on together, a
+ *board current limit can be set along with the inrush and steady currents of
+ *each rail.  The rails are then switched on one after another, each as soon as
+ *its inrush fits under the limit with the current already being drawn by the
+ *rails that are on.
+*/
+
+// Header Guards
+#ifndef PowerRail_h
+#define PowerRail_h
+
+// Debugging Statement
+// #define MS_POWERRAIL_DEBUG
+
+#ifdef MS_POWERRAIL_DEBUG
+#define MS_DEBUGGING_STD "PowerRail"
+#endif
+
+// Included Dependencies
+#include "ModSensorDebugger.h"
+#undef MS_DEBUGGING_STD
+
+// The largest number of different power pins
+#define POWER_RAIL_MAX_RAILS 6
+
+// The default length of the inrush when a rail is switched on
+#define POWER_RAIL_DEFAULT_INRUSH_MS 50
+
+// The register widths differ between processors
+#if defined(__AVR__)
+typedef volatile uint8_t powerPortReg_t;
+typedef uint8_t powerPortMask_t;
+#else
+typedef volatile uint32_t powerPortReg_t;
+typedef uint32_t powerPortMask_t;
+#endif
+
+
+class PowerRail
+{
+public:
+    // This returns the rail for a power pin, creating it the first time the
+    // pin is asked for.  Returns NULL for a negative pin or if all of the
+    // rails are already in use.
+    static PowerRail *getRail(int8_t powerPin);
+
+    int8_t getPowerPin(void){return _powerPin;}
+
+    // This checks if the rail is currently powered with a single read of the
+    // pin's port register
+    bool isOn(void){return (*_inputRegister & _bitMask) != 0;}
+
+    // This takes a hold on the power, switching it on if no one else has it,
+    // and returns the time the rail came up
+    uint32_t powerUp(void);
+    // This lets go of the power, switching it off if no one else is holding
+    // it.  Returns true if the power was switched off.
+    bool powerDown(void);
+
+    // This returns the time the rail came up; 0 if the rail is off
+    uint32_t getMillisPowerOn(void);
+    // The number of sensors currently holding the power
+    uint8_t getHoldCount(void){return _holdCount;}
+
+    // This sets the current drawn by everything on the rail for the first
+    // inrushTime_ms after it is switched on, and after that
+    void setCurrentDraw(float inrush_mA, float steady_mA,
+                        uint32_t inrushTime_ms = POWER_RAIL_DEFAULT_INRUSH_MS);
+    // This returns the current the rail is expected to be drawing right now
+    float getCurrentDraw(uint32_t now);
+    // This sets the most current all of the rails together may draw; 0 (the
+    // default) for no limit
+    static void setCurrentLimit(float currentLimit_mA);
+    static float getCurrentLimit(void){return _currentLimit_mA;}
+    // This checks if the rail can be switched on now without going over the
+    // current limit.  If the limit can't be met even once all the other
+    // rails are past their inrush, waiting won't help and this returns true.
+    bool canPowerUp(void);
+
+    // The statistics on the time the rail is on
+    uint16_t getPowerOnCount(void){return _powerOnCount;}
+    uint32_t getLastOnTime(void){return _lastOnTime_ms;}
+    uint32_t getTotalOnTime(void){return _totalOnTime_ms;}
+
+protected:
+    PowerRail();
+    void begin(int8_t powerPin);
+
+    int8_t _powerPin;
+    powerPortReg_t *_inputRegister;
+    powerPortMask_t _bitMask;
+
+    uint8_t _holdCount;
+    uint32_t _millisPowerOn;
+    uint16_t _powerOnCount;
+    uint32_t _lastOnTime_ms;
+    uint32_t _totalOnTime_ms;
+
+    float _inrushCurrent_mA;
+    float _steadyCurrent_mA;
+    uint32_t _inrushTime_ms;
+
+private:
+    static PowerRail _rails[POWER_RAIL_MAX_RAILS];
+    static uint8_t _railCount;
+    static float _currentLimit_mA;
+};
+
+#endif  // Header Guard
@@ -9,6 +9,8 @@
 
 #include "SensorBase.h"
 #include "VariableBase.h"
+#include "SensorStatistics.h"
+#include "SensorTelemetry.h"
 
 // ============================================================================
 //  The class and functions for interfacing with a sensor
@@ -21,6 +23,8 @@ Sensor::Sensor(const char *sensorName, const uint8_t numReturnedVars,
   : _sensorName(sensorName), _numReturnedVars(numReturnedVars)
 {
     _powerPin = powerPin;
+    _powerRail = NULL;
+    _holdingPower = false;
     _dataPin = dataPin;
     _measurementsToAverage = measurementsToAverage;
 
@@ -58,6 +62,9 @@ Sensor::Sensor(const char *sensorName, const uint8_t numReturnedVars,
     // Reset the sensor status
     _sensorStatus = 0;
 
+    _statistics = NULL;
+    _telemetry = NULL;
+
     // MS_DBG(F("Sensor object created"));
 }
 // Destructor
@@ -88,6 +95,14 @@ String Sensor::getSensorNameAndLocation(void)
 int8_t Sensor::getPowerPin(void){return _powerPin;}
 
 
+// This returns the power rail, looking it up the first time
+PowerRail *Sensor::getPowerRail(void)
+{
+    if (_powerRail == NULL && _powerPin >= 0) _powerRail = PowerRail::getRail(_powerPin);
+    return _powerRail;
+}
+
+
 // These functions get and set the number of readings to average for a sensor
 // Generally these values should be set in the constructor
 void Sensor::setNumberMeasurementsToAverage(int nReadings)
@@ -120,9 +135,9 @@ void Sensor::powerUp(void)
     {
         MS_DBG(F("Powering"), getSensorNameAndLocation(),
                F("with pin"), _powerPin);
-        digitalWrite(_powerPin, HIGH);
-        // Mark the time that the sensor was powered
-        _millisPowerOn = millis();
+        // Mark the time that the sensor was powered - or that the rail it
+        // shares came up, if it was already on
+        holdPower();
     }
     else
     {
@@ -131,6 +146,7 @@ void Sensor::powerUp(void)
         // Mark the power-on time, just in case it  had not been marked
         if (_millisPowerOn == 0) _millisPowerOn = millis();
     }
+    if (_telemetry != NULL) _telemetry->powerOn(millis());
     // Set the status bit for sensor power attempt (bit 1) and success (bit 2)
     _sensorStatus |= 0b00000110;
 }
@@ -143,7 +159,8 @@ void Sensor::powerDown(void)
     {
         MS_DBG(F("Turning off power to"), getSensorNameAndLocation(),
                F("with pin"), _powerPin);
-        digitalWrite(_powerPin, LOW);
+        releasePower();
+        if (_telemetry != NULL) _telemetry->powerOff(millis());
         // Unset the power-on time
         _millisPowerOn = 0;
         // Unset the activation time
@@ -163,6 +180,34 @@ void Sensor::powerDown(void)
 }
 
 
+void Sensor::holdPower(void)
+{
+    PowerRail *rail = getPowerRail();
+    if (rail == NULL)
+    {
+        digitalWrite(_powerPin, HIGH);
+        _millisPowerOn = millis();
+        return;
+    }
+    if (!_holdingPower)
+    {
+        rail->powerUp();
+        _holdingPower = true;
+    }
+    _millisPowerOn = rail->getMillisPowerOn();
+}
+
+
+void Sensor::releasePower(void)
+{
+    PowerRail *rail = getPowerRail();
+    if (rail == NULL) digitalWrite(_powerPin, LOW);
+    // Switch off a rail no one is holding, in case something else turned it on
+    else if (_holdingPower || rail->getHoldCount() == 0) rail->powerDown();
+    _holdingPower = false;
+}
+
+
 // The function to set up connection to a sensor.
 // By default, sets pin modes and returns true
 bool Sensor::setup(void)
@@ -178,6 +223,7 @@ bool Sensor::setup(void)
     MS_DBG(_measurementsToAverage, F("individual measurements will be averaged for each reading."));
 
     if (_powerPin >= 0) pinMode(_powerPin, OUTPUT);  // NOTE:  Not setting value
+    getPowerRail();
     if (_dataPin >= 0) pinMode(_dataPin, INPUT);  // NOTE:  Not turning on pull-up!
 
     // Set the status bit marking that the sensor has been set up (bit 0)
@@ -209,6 +255,7 @@ bool Sensor::wake(void)
     _millisSensorActivated = millis();
     // Set the status bit for sensor wake/activation success (bit 4)
     _sensorStatus |= 0b00010000;
+    if (_telemetry != NULL) _telemetry->woke(_millisSensorActivated, _warmUpTime_ms);
 
     return true;
 }
@@ -263,6 +310,9 @@ bool Sensor::startSingleMeasurement(void)
         _millisMeasurementRequested = millis();
         // Set the status bit for measurement start success (bit 6)
         _sensorStatus |= 0b01000000;
+        if (_telemetry != NULL)
+            _telemetry->measurementStarted(_millisMeasurementRequested,
+                                           _millisSensorActivated, _stabilizationTime_ms);
     }
     // Otherwise, make sure that the measurement start time and success bit (bit 6) are unset
     else
@@ -303,9 +353,14 @@ void Sensor::notifyVariables(void)
     MS_DBG(F("Notifying variables registered to"), getSensorNameAndLocation(),
            F("of value update."));
 
+    // Fill in any diagnostic results before the variables pick them up
+    if (_telemetry != NULL) _telemetry->fillResults(sensorValues, _numReturnedVars);
+
     // Notify variables of update
-    for (uint8_t i = 0; i < _numReturnedVars; i++)
+    // Variables beyond the number returned by the sensor report derived statistics
+    for (uint8_t i = 0; i < MAX_NUMBER_VARS; i++)
     {
+        if (i >= _numReturnedVars && variables[i] == NULL) continue;
         if (variables[i] != NULL)  // Bad things happen if try to update nullptr
         {
             MS_DBG(F("Sending value update from"), getSensorNameAndLocation(),
@@ -329,6 +384,8 @@ void Sensor::clearValues(void)
         sensorValues[i] =  -9999;
         numberGoodMeasurementsMade[i] = 0;
     }
+    if (_statistics != NULL) _statistics->clear();
+    if (_telemetry != NULL) _telemetry->clear();
 }
 
 
@@ -343,6 +400,7 @@ void Sensor::verifyAndAddMeasurementResult(uint8_t resultNumber, float resultVal
                resultNumber, F("from"), getSensorNameAndLocation());
         sensorValues[resultNumber] =  resultValue;
         numberGoodMeasurementsMade[resultNumber] += 1;
+        if (_statistics != NULL) _statistics->addSample(resultNumber, resultValue);
     }
     // If the new result is good and there were already good results in place
     // add the new results to the total and add 1 to the good result total
@@ -352,6 +410,7 @@ void Sensor::verifyAndAddMeasurementResult(uint8_t resultNumber, float resultVal
                resultNumber, F("from"), getSensorNameAndLocation());
         sensorValues[resultNumber] +=  resultValue;
         numberGoodMeasurementsMade[resultNumber] += 1;
+        if (_statistics != NULL) _statistics->addSample(resultNumber, resultValue);
     }
     // If the new result is bad and there were only bad results, do nothing
     else if (sensorValues[resultNumber] == -9999 and resultValue == -9999)
@@ -381,6 +440,33 @@ void Sensor::averageMeasurements(void)
             sensorValues[i] /=  numberGoodMeasurementsMade[i];
         MS_DBG(F("    ->Result #"), i, ':', sensorValues[i]);
     }
+    // Swap in any other statistics asked for in place of the means
+    if (_statistics != NULL) _statistics->aggregate(sensorValues, _numReturnedVars);
+}
+
+
+void Sensor::setStatistics(SensorStatistics& statistics)
+{
+    _statistics = &statistics;
+}
+
+
+bool Sensor::hasConverged(void)
+{
+    if (_statistics == NULL) return false;
+    return _statistics->hasConverged();
+}
+
+
+void Sensor::setTelemetry(SensorTelemetry& telemetry)
+{
+    _telemetry = &telemetry;
+}
+
+
+void Sensor::recordMeasurementResult(bool success)
+{
+    if (_telemetry != NULL) _telemetry->measurementFinished(millis(), success);
 }
 
 
@@ -419,7 +505,15 @@ bool Sensor::update(void)
         // wait for the measurement to finish
         waitForMeasurementCompletion();
         // get the measurement result
-        ret_val += addSingleMeasurementResult();
+        bool success = addSingleMeasurementResult();
+        recordMeasurementResult(success);
+        ret_val += success;
+        // stop early if the readings have already settled
+        if (hasConverged())
+        {
+            MS_DBG(getSensorNameAndLocation(), F("converged after"), j + 1, F("reading[s]"));
+            break;
+        }
     }
 
     averageMeasurements();
@@ -443,9 +537,7 @@ bool Sensor::checkPowerOn(bool debug)
     if (debug) {MS_DBG(F("Checking power status:  Power to"), getSensorNameAndLocation());}
     if (_powerPin >= 0)
     {
-        int8_t powerBitNumber = log(digitalPinToBitMask(_powerPin))/log(2);
-
-        if (bitRead(*portInputRegister(digitalPinToPort(_powerPin)), powerBitNumber) == LOW)
+        if (!isPowerOn())
         {
             if (debug) {MS_DBG(F("was off."));}
             // Reset time of power on, in-case it was set to a value
@@ -459,6 +551,9 @@ bool Sensor::checkPowerOn(bool debug)
         {
             if (debug) {MS_DBG((" was on."));}
             // Mark the power-on time, just in case it  had not been marked
+            // Use the time the rail came up, if it's known
+            if (_millisPowerOn == 0 && _powerRail != NULL)
+                _millisPowerOn = _powerRail->getMillisPowerOn();
             if (_millisPowerOn == 0) _millisPowerOn = millis();
             // Set the status bit for sensor power attempt (bit 1) and success (bit 2)
             _sensorStatus |= 0b00000110;
@@ -477,6 +572,18 @@ bool Sensor::checkPowerOn(bool debug)
 }
 
 
+// This checks the power pin without changing anything
+bool Sensor::isPowerOn(void)
+{
+    if (_powerPin < 0) return true;
+    PowerRail *rail = getPowerRail();
+    if (rail != NULL) return rail->isOn();
+    // If there was no room for a rail, read the pin the long way
+    return (*portInputRegister(digitalPinToPort(_powerPin)) &
+            digitalPinToBitMask(_powerPin)) != 0;
+}
+
+
 // This checks to see if enough time has passed for warm-up
 bool Sensor::isWarmedUp(bool debug)
 {
@@ -22,12 +22,15 @@
 #include "ModSensorDebugger.h"
 #undef MS_DEBUGGING_STD
 #include <pins_arduino.h>
+#include "PowerRail.h"
 
 // The largest number of variables from a single sensor
 #define MAX_NUMBER_VARS 8
 
 
 class Variable;  // Forward declaration
+class SensorStatistics;  // Forward declaration
+class SensorTelemetry;  // Forward declaration
 
 // Defines the "Sensor" Class
 class Sensor
@@ -48,6 +51,11 @@ public:
     String getSensorNameAndLocation(void);
     // This gets the pin number for the power pin.
     virtual int8_t getPowerPin(void);
+    // This gets the power rail shared by all sensors on the same power pin;
+    // NULL if the power is not controlled by this library.
+    PowerRail *getPowerRail(void);
+    // This gets the time the sensor needs from power on until it can respond
+    uint32_t getWarmUpTime(void){return _warmUpTime_ms;}
 
     // These functions get and set the number of readings to average for a sensor
     // Generally these values should be set in the constructor
@@ -131,6 +139,23 @@ public:
     void verifyAndAddMeasurementResult(uint8_t resultNumber, int16_t resultValue);
     void averageMeasurements(void);
 
+    // This attaches statistics to keep on the repeated measurements from
+    // this sensor.  See SensorStatistics.h.
+    void setStatistics(SensorStatistics& statistics);
+    SensorStatistics *getStatistics(void){return _statistics;}
+    // This checks if the measurements so far have converged so no more need
+    // to be averaged.  The criteria are set on the statistics; without
+    // statistics attached, all of the requested measurements are always taken.
+    bool hasConverged(void);
+
+    // This attaches timing and energy telemetry to this sensor.
+    // See SensorTelemetry.h.
+    void setTelemetry(SensorTelemetry& telemetry);
+    SensorTelemetry *getTelemetry(void){return _telemetry;}
+    // This must be called with the return of each addSingleMeasurementResult()
+    // to count the measurements and the time lost to failed ones.
+    void recordMeasurementResult(bool success);
+
     // These tie the variables to their parent sensor
     void registerVariable(int sensorVarNum, Variable* var);
     // Notifies attached variables of new values
@@ -139,8 +164,11 @@ public:
     // The "isWarmedUp()" function checks whether or not enough time has passed
     // between the sensor receiving power and being ready to respond to logger
     // commands.  The "waitForWarmUp()" function delays until the time passes.
-    // "checkPowerOn()" checks if the power pin is currently high
+    // "checkPowerOn()" checks if the power pin is currently high and updates
+    // the status bits and timestamps to match
+    // "isPowerOn()" only checks the power pin - it's a single register read
     bool checkPowerOn(bool debug=false);
+    bool isPowerOn(void);
     virtual bool isWarmedUp(bool debug=false);
     void waitForWarmUp(void);
 
@@ -162,6 +190,8 @@ protected:
 
     int8_t _dataPin;  // SIGNED int, to allow negative numbers for unused pins
     int8_t _powerPin;  // SIGNED int, to allow negative numbers for unused pins
+    PowerRail *_powerRail;  // Looked up from the power pin at setup
+    bool _holdingPower;  // If this sensor holds its power rail on
     const char *_sensorName;
     const uint8_t _numReturnedVars;
     uint8_t _measurementsToAverage;
@@ -190,11 +220,22 @@ protected:
     // This is an 8-bit code for the sensor status
     uint8_t _sensorStatus;
 
+    // The statistics kept on the measurements, if any
+    SensorStatistics *_statistics;
+    // The timing and energy telemetry kept, if any
+    SensorTelemetry *_telemetry;
+
     // This is an array for each sensor containing the variable objects tied
     // to that sensor.  The MAX_NUMBER_VARS cannot be determined on a per-sensor
     // basis, because of the way memory is used on an Arduino.  It must be
     // defined once for the whole class.
     Variable *variables[MAX_NUMBER_VARS];
+
+    // These take and let go of a hold on the power rail of the power pin,
+    // setting _millisPowerOn to the time the rail came up.  The pin is only
+    // switched off when no other sensor is holding it.
+    void holdPower(void);
+    void releasePower(void);
 };
 
 #endif  // Header Guard
@@ -0,0 +1,264 @@
+/*
+ *SensorStatistics.cpp
+ *This file is part of the EnviroDIY modular sensors library for Arduino
+ *
+ *Initial library developement done by Sara Damiano (sdamiano@stroudcenter.org).
+ *
+ *This file is for the statistics kept on the repeated measurements from a
+ *sensor.
+*/
+
+#include "SensorStatistics.h"
+
+
+SensorStatistics::SensorStatistics(float *sampleBuffer, uint8_t maxSamples)
+{
+    _sampleBuffer = sampleBuffer;
+    _maxSamples = sampleBuffer == NULL ? 0 : maxSamples;
+    _trimFraction = STATS_DEFAULT_TRIM_FRACTION;
+    _convergenceVar = 0xFF;
+    _minConvergenceCount = STATS_DEFAULT_MIN_CONVERGENCE;
+    _maxStandardError = 0;
+    _convergenceWindow = 0;
+    _convergenceTolerance = 0;
+    for (uint8_t i = 0; i < MAX_NUMBER_VARS; i++)
+    {
+        _aggregation[i] = STAT_MEAN;
+        _derivedSource[i] = 0xFF;
+        _derivedStatistic[i] = STAT_MEAN;
+    }
+    clear();
+}
+SensorStatistics::~SensorStatistics(){}
+
+
+void SensorStatistics::setAggregation(uint8_t varNum, sensorStatistic_t statistic)
+{
+    if (varNum < MAX_NUMBER_VARS) _aggregation[varNum] = statistic;
+}
+sensorStatistic_t SensorStatistics::getAggregation(uint8_t varNum)
+{
+    return (sensorStatistic_t)_aggregation[varNum];
+}
+
+
+bool SensorStatistics::addDerivedResult(uint8_t sourceVarNum, sensorStatistic_t statistic,
+                                        uint8_t resultVarNum)
+{
+    if (sourceVarNum >= MAX_NUMBER_VARS || resultVarNum >= MAX_NUMBER_VARS) return false;
+    _derivedSource[resultVarNum] = sourceVarNum;
+    _derivedStatistic[resultVarNum] = statistic;
+    return true;
+}
+
+
+void SensorStatistics::setTrimFraction(float trimFraction)
+{
+    _trimFraction = constrain(trimFraction, 0, 0.49);
+}
+
+
+void SensorStatistics::setConvergence(uint8_t varNum, float maxStandardError,
+                                      uint8_t minMeasurements)
+{
+    _convergenceVar = varNum < MAX_NUMBER_VARS ? varNum : 0xFF;
+    _maxStandardError = maxStandardError;
+    // The standard error needs at least two samples
+    _minConvergenceCount = max(minMeasurements, (uint8_t)2);
+}
+
+
+void SensorStatistics::setConvergenceWindow(uint8_t windowSize, float tolerance)
+{
+    _convergenceWindow = windowSize;
+    _convergenceTolerance = tolerance;
+    if (windowSize > _maxSamples)
+    {
+        MS_DBG(F("Convergence window of"), windowSize, F("is larger than the sample buffer of"),
+               _maxSamples, F("; it will not be used"));
+    }
+}
+
+
+bool SensorStatistics::hasConverged(void)
+{
+    if (_convergenceVar >= MAX_NUMBER_VARS) return false;
+    uint8_t n = _count[_convergenceVar];
+    if (n < _minConvergenceCount) return false;
+
+    if (_maxStandardError > 0)
+    {
+        float standardError = getStandardError(_convergenceVar);
+        if (standardError != -9999 && standardError <= _maxStandardError)
+        {
+            MS_DBG(F("Converged after"), n, F("samples with a standard error of"), standardError);
+            return true;
+        }
+    }
+
+    // The samples are only in the order taken while the buffer isn't full
+    if (_convergenceWindow > 1 && n >= _convergenceWindow && n <= _maxSamples)
+    {
+        float *samples = getSamples(_convergenceVar);
+        float low = samples[n - _convergenceWindow];
+        float high = low;
+        for (uint8_t j = n - _convergenceWindow + 1; j < n; j++)
+        {
+            if (samples[j] < low) low = samples[j];
+            if (samples[j] > high) high = samples[j];
+        }
+        if (high - low <= _convergenceTolerance)
+        {
+            MS_DBG(F("Converged after"), n, F("samples; the last"), _convergenceWindow,
+                   F("are within"), high - low);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void SensorStatistics::clear(void)
+{
+    for (uint8_t i = 0; i < MAX_NUMBER_VARS; i++)
+    {
+        _count[i] = 0;
+        _mean[i] = 0;
+        _m2[i] = 0;
+        _min[i] = -9999;
+        _max[i] = -9999;
+    }
+}
+
+
+// This adds a good sample to the running statistics and the sample buffer
+void SensorStatistics::addSample(uint8_t varNum, float value)
+{
+    if (varNum >= MAX_NUMBER_VARS || value == -9999) return;
+
+    // Keep the sample for the median, if there's room
+    if (_count[varNum] < _maxSamples) getSamples(varNum)[_count[varNum]] = value;
+    else if (_maxSamples > 0)
+    {
+        MS_DBG(F("Sample buffer full for variable"), varNum,
+               F("; median and trimmed mean use the first"), _maxSamples, F("samples"));
+    }
+
+    if (_count[varNum] == 0 || value < _min[varNum]) _min[varNum] = value;
+    if (_count[varNum] == 0 || value > _max[varNum]) _max[varNum] = value;
+
+    // Welford's algorithm keeps the variance without the loss of precision
+    // of a sum of squares in a single precision float.
+    _count[varNum]++;
+    float delta = value - _mean[varNum];
+    _mean[varNum] += delta/_count[varNum];
+    _m2[varNum] += delta*(value - _mean[varNum]);
+}
+
+
+// This replaces the averaged values with the chosen statistic and fills in
+// the derived results
+void SensorStatistics::aggregate(float values[], uint8_t numReturnedVars)
+{
+    for (uint8_t i = 0; i < numReturnedVars; i++)
+    {
+        if (_aggregation[i] != STAT_MEAN && _count[i] > 0)
+        {
+            values[i] = getStatistic(i, (sensorStatistic_t)_aggregation[i]);
+        }
+    }
+    for (uint8_t i = numReturnedVars; i < MAX_NUMBER_VARS; i++)
+    {
+        if (_derivedSource[i] < MAX_NUMBER_VARS)
+        {
+            values[i] = getStatistic(_derivedSource[i], (sensorStatistic_t)_derivedStatistic[i]);
+            MS_DBG(F("    ->Derived result #"), i, ':', values[i]);
+        }
+    }
+}
+
+
+float SensorStatistics::getStatistic(uint8_t varNum, sensorStatistic_t statistic)
+{
+    if (varNum >= MAX_NUMBER_VARS) return -9999;
+    if (statistic == STAT_COUNT) return _count[varNum];
+    if (_count[varNum] == 0) return -9999;
+
+    switch (statistic)
+    {
+        case STAT_MEAN: return getMean(varNum);
+        case STAT_MIN: return _min[varNum];
+        case STAT_MAX: return _max[varNum];
+        case STAT_STDDEV: return getStandardDeviation(varNum);
+        case STAT_MEDIAN:
+        {
+            uint8_t n = sortSamples(varNum);
+            if (n == 0) return -9999;
+            float *samples = getSamples(varNum);
+            if (n % 2) return samples[n/2];
+            return (samples[n/2 - 1] + samples[n/2])/2;
+        }
+        case STAT_TRIMMED_MEAN:
+        {
+            uint8_t n = sortSamples(varNum);
+            if (n == 0) return -9999;
+            float *samples = getSamples(varNum);
+            uint8_t nTrim = n*_trimFraction;
+            float sum = 0;
+            for (uint8_t j = nTrim; j < n - nTrim; j++) sum += samples[j];
+            return sum/(n - 2*nTrim);
+        }
+        default: return -9999;
+    }
+}
+
+
+float SensorStatistics::getMean(uint8_t varNum)
+{
+    if (_count[varNum] == 0) return -9999;
+    return _mean[varNum];
+}
+
+
+// The sample standard deviation
+float SensorStatistics::getStandardDeviation(uint8_t varNum)
+{
+    if (_count[varNum] < 2) return -9999;
+    return sqrt(_m2[varNum]/(_count[varNum] - 1));
+}
+
+
+// The standard error of the mean
+float SensorStatistics::getStandardError(uint8_t varNum)
+{
+    if (_count[varNum] < 2) return -9999;
+    return getStandardDeviation(varNum)/sqrt(_count[varNum]);
+}
+
+
+float *SensorStatistics::getSamples(uint8_t varNum)
+{
+    return _sampleBuffer + (uint16_t)varNum*_maxSamples;
+}
+
+
+// This sorts the buffered samples of a variable and returns how many there are
+// The order they were taken in isn't needed for anything else.
+uint8_t SensorStatistics::sortSamples(uint8_t varNum)
+{
+    uint8_t n = min(_count[varNum], _maxSamples);
+    float *samples = getSamples(varNum);
+    // Insertion sort - there are never more than a handful of samples
+    for (uint8_t i = 1; i < n; i++)
+    {
+        float value = samples[i];
+        uint8_t j = i;
+        while (j > 0 && samples[j - 1] > value)
+        {
+            samples[j] = samples[j - 1];
+            j--;
+        }
+        samples[j] = value;
+    }
+    return n;
+}
@@ -0,0 +1,147 @@
+/*
+ *SensorStatistics.h
+ *This file is part of the EnviroDIY modular sensors library for Arduino
+ *
+ *Initial library developement done by Sara Damiano (sdamiano@stroudcenter.org).
+ *
+ *This file is for the statistics kept on the repeated measurements from a
+ *sensor.  By default, a sensor reports only the mean of the measurements it
+ *averages.  Attaching a SensorStatistics object to a sensor lets each variable
+ *instead report the median, minimum, maximum or trimmed mean, and lets the
+ *standard deviation (or any other statistic) be reported as another variable.
+ *
+ *The mean, variance, minimum and maximum are kept as the samples come in.  The
+ *median and trimmed mean need the samples themselves; those are kept in a
+ *fixed-size buffer, sized by the template parameter of SensorStatisticsBuffer.
+ *
+ *The statistics can also end the averaging early:  once the standard error of
+ *the mean of one variable is small enough, or its last few samples agree
+ *within a tolerance, the sensor reports that it has converged and no further
+ *measurements are taken.
+*/
+
+// Header Guards
+#ifndef SensorStatistics_h
+#define SensorStatistics_h
+
+// Debugging Statement
+// #define MS_SENSORSTATISTICS_DEBUG
+
+#ifdef MS_SENSORSTATISTICS_DEBUG
+#define MS_DEBUGGING_STD "SensorStatistics"
+#endif
+
+// Included Dependencies
+#include "ModSensorDebugger.h"
+#undef MS_DEBUGGING_STD
+#include "SensorBase.h"
+
+// The default fraction of samples cut from each end for a trimmed mean
+#define STATS_DEFAULT_TRIM_FRACTION 0.2
+// The default minimum number of samples before averaging can end early
+#define STATS_DEFAULT_MIN_CONVERGENCE 3
+
+// The statistics that can be reported for a variable
+typedef enum sensorStatistic_t
+{
+    STAT_MEAN = 0,
+    STAT_MEDIAN,
+    STAT_MIN,
+    STAT_MAX,
+    STAT_STDDEV,
+    STAT_TRIMMED_MEAN,
+    STAT_COUNT
+} sensorStatistic_t;
+
+
+// The statistics for all of the variables of a single sensor
+// Use this directly if no median or trimmed mean is needed; otherwise use the
+// SensorStatisticsBuffer template below to give it space for the samples.
+class SensorStatistics
+{
+public:
+    SensorStatistics(float *sampleBuffer = NULL, uint8_t maxSamples = 0);
+    ~SensorStatistics();
+
+    // This sets which statistic is reported as the value of a variable
+    // The default is the mean, as without statistics.
+    void setAggregation(uint8_t varNum, sensorStatistic_t statistic);
+    sensorStatistic_t getAggregation(uint8_t varNum);
+
+    // This puts a statistic of one variable into an otherwise unused result
+    // number of the sensor, so a Variable attached to the sensor with that
+    // result number will report it.  The result number must be at or beyond
+    // the number of values the sensor returns and less than MAX_NUMBER_VARS.
+    bool addDerivedResult(uint8_t sourceVarNum, sensorStatistic_t statistic,
+                          uint8_t resultVarNum);
+
+    // This sets the fraction of samples cut from each end for a trimmed mean
+    void setTrimFraction(float trimFraction);
+
+    // This ends the averaging early once the standard error of the mean of a
+    // variable is at or below maxStandardError and at least minMeasurements
+    // good samples have been taken.  A maxStandardError of 0 disables it.
+    void setConvergence(uint8_t varNum, float maxStandardError,
+                        uint8_t minMeasurements = STATS_DEFAULT_MIN_CONVERGENCE);
+    // This also ends the averaging once the last windowSize samples are all
+    // within tolerance of each other.  This needs a sample buffer.
+    void setConvergenceWindow(uint8_t windowSize, float tolerance);
+    // This checks the convergence criteria against the samples so far
+    bool hasConverged(void);
+
+    // These are called by the sensor as it takes and averages measurements
+    void clear(void);
+    void addSample(uint8_t varNum, float value);
+    void aggregate(float values[], uint8_t numReturnedVars);
+
+    // These return the current statistics of a variable; -9999 if there are
+    // not enough samples (or no sample buffer, for the median and trimmed mean)
+    float getStatistic(uint8_t varNum, sensorStatistic_t statistic);
+    uint8_t getCount(uint8_t varNum){return _count[varNum];}
+    float getMean(uint8_t varNum);
+    float getStandardDeviation(uint8_t varNum);
+    float getStandardError(uint8_t varNum);
+
+protected:
+    float *_sampleBuffer;
+    uint8_t _maxSamples;
+    float _trimFraction;
+
+    // The streaming statistics (Welford's algorithm for the variance)
+    uint8_t _count[MAX_NUMBER_VARS];
+    float _mean[MAX_NUMBER_VARS];
+    float _m2[MAX_NUMBER_VARS];
+    float _min[MAX_NUMBER_VARS];
+    float _max[MAX_NUMBER_VARS];
+
+    uint8_t _aggregation[MAX_NUMBER_VARS];
+    // For each result number, the variable and statistic it reports, if any
+    uint8_t _derivedSource[MAX_NUMBER_VARS];
+    uint8_t _derivedStatistic[MAX_NUMBER_VARS];
+
+    // The convergence criteria; a variable number of 0xFF means none
+    uint8_t _convergenceVar;
+    uint8_t _minConvergenceCount;
+    float _maxStandardError;
+    uint8_t _convergenceWindow;
+    float _convergenceTolerance;
+
+private:
+    float *getSamples(uint8_t varNum);
+    uint8_t sortSamples(uint8_t varNum);
+};
+
+
+// Statistics with space to keep up to MAX_SAMPLES samples of each variable
+// NOTE:  This takes 4 x MAX_NUMBER_VARS x MAX_SAMPLES bytes of RAM!
+template <uint8_t MAX_SAMPLES>
+class SensorStatisticsBuffer : public SensorStatistics
+{
+public:
+    SensorStatisticsBuffer() : SensorStatistics(&_buffer[0][0], MAX_SAMPLES) {}
+
+private:
+    float _buffer[MAX_NUMBER_VARS][MAX_SAMPLES];
+};
+
+#endif  // Header Guard
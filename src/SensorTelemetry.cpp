@@ -0,0 +1,169 @@
+/*
+ *SensorTelemetry.cpp
+ *This file is part of the EnviroDIY modular sensors library for Arduino
+ *
+ *Initial library developement done by Sara Damiano (sdamiano@stroudcenter.org).
+ *
+ *This file is for the timing and energy telemetry kept on a sensor.
+*/
+
+#include "SensorTelemetry.h"
+
+
+SensorTelemetry::SensorTelemetry(float currentDraw_mA)
+{
+    _currentDraw_mA = currentDraw_mA;
+    _millisPowerOn = 0;
+    _powerOnTime_ms = 0;
+    _millisLastActive = 0;
+    _warmUpSlack_ms = 0;
+    for (uint8_t i = 0; i < MAX_NUMBER_VARS; i++) _diagnosticItem[i] = 0xFF;
+    clear();
+}
+SensorTelemetry::~SensorTelemetry(){}
+
+
+void SensorTelemetry::setCurrentDraw(float currentDraw_mA)
+{
+    _currentDraw_mA = currentDraw_mA;
+}
+
+
+bool SensorTelemetry::addDiagnosticResult(sensorTelemetry_t item, uint8_t resultVarNum)
+{
+    if (resultVarNum >= MAX_NUMBER_VARS) return false;
+    _diagnosticItem[resultVarNum] = item;
+    return true;
+}
+
+
+// This starts a new cycle
+void SensorTelemetry::powerOn(uint32_t now)
+{
+    _millisPowerOn = now;
+    _millisLastActive = now;
+    _powerOnTime_ms = 0;
+    _warmUpSlack_ms = 0;
+}
+
+
+void SensorTelemetry::powerOff(uint32_t now)
+{
+    if (_millisPowerOn == 0) return;
+    _powerOnTime_ms = now - _millisPowerOn;
+    _millisPowerOn = 0;
+    MS_DBG(F("Powered for"), _powerOnTime_ms, F("ms"));
+}
+
+
+// If the sensor wasn't powered up this cycle, it has long since warmed up and
+// there's no slack to count
+void SensorTelemetry::woke(uint32_t now, uint32_t warmUpTime_ms)
+{
+    uint32_t elapsed = now - _millisPowerOn;
+    if (_millisPowerOn == 0 || elapsed <= warmUpTime_ms) _warmUpSlack_ms = 0;
+    else _warmUpSlack_ms = elapsed - warmUpTime_ms;
+    _millisLastActive = now;
+}
+
+
+void SensorTelemetry::measurementStarted(uint32_t now, uint32_t millisSensorActivated,
+                                         uint32_t stabilizationTime_ms)
+{
+    // Only the wait before the first measurement of a cycle is slack; later
+    // measurements start as soon as the one before them is done.
+    if (_millisMeasurementStarted == 0)
+    {
+        uint32_t elapsed = now - millisSensorActivated;
+        _stabilizationSlack_ms = elapsed > stabilizationTime_ms ?
+                                 elapsed - stabilizationTime_ms : 0;
+    }
+    _millisMeasurementStarted = now;
+}
+
+
+void SensorTelemetry::measurementFinished(uint32_t now, bool success)
+{
+    if (success) _measurementCount++;
+    else
+    {
+        _failedCount++;
+        if (_millisMeasurementStarted != 0) _failedTime_ms += now - _millisMeasurementStarted;
+    }
+    _millisLastActive = now;
+}
+
+
+void SensorTelemetry::clear(void)
+{
+    _millisMeasurementStarted = 0;
+    _stabilizationSlack_ms = 0;
+    _failedTime_ms = 0;
+    _measurementCount = 0;
+    _failedCount = 0;
+}
+
+
+void SensorTelemetry::fillResults(float values[], uint8_t numReturnedVars)
+{
+    for (uint8_t i = numReturnedVars; i < MAX_NUMBER_VARS; i++)
+    {
+        if (_diagnosticItem[i] != 0xFF)
+        {
+            values[i] = getTelemetry((sensorTelemetry_t)_diagnosticItem[i]);
+            MS_DBG(F("    ->Diagnostic result #"), i, ':', values[i]);
+        }
+    }
+}
+
+
+float SensorTelemetry::getTelemetry(sensorTelemetry_t item)
+{
+    switch (item)
+    {
+        case TELEM_POWER_ON_MS: return getPowerOnTime();
+        case TELEM_WARM_UP_SLACK_MS: return _warmUpSlack_ms;
+        case TELEM_STABILIZATION_SLACK_MS: return _stabilizationSlack_ms;
+        case TELEM_MEASUREMENT_COUNT: return _measurementCount;
+        case TELEM_FAILED_COUNT: return _failedCount;
+        case TELEM_FAILED_MS: return _failedTime_ms;
+        case TELEM_CHARGE_MAH: return getCharge_mAh();
+        default: return -9999;
+    }
+}
+
+
+// If the power is still on (or isn't controlled by the library) the time runs
+// until the last thing the sensor did
+uint32_t SensorTelemetry::getPowerOnTime(void)
+{
+    if (_millisPowerOn == 0) return _powerOnTime_ms;
+    return _millisLastActive - _millisPowerOn;
+}
+
+
+// mA x ms / 3,600,000 ms/hr
+float SensorTelemetry::getCharge_mAh(void)
+{
+    return _currentDraw_mA*getPowerOnTime()/3600000.0;
+}
+
+
+void SensorTelemetry::printTelemetry(Stream *stream)
+{
+    stream->print(F("powered "));
+    stream->print(getPowerOnTime());
+    stream->print(F(" ms (warm-up slack "));
+    stream->print(_warmUpSlack_ms);
+    stream->print(F(" ms, stabilization slack "));
+    stream->print(_stabilizationSlack_ms);
+    stream->print(F(" ms), "));
+    stream->print(_measurementCount);
+    stream->print(F(" good and "));
+    stream->print(_failedCount);
+    stream->print(F(" failed measurements ("));
+    stream->print(_failedTime_ms);
+    stream->print(F(" ms lost), "));
+    stream->print(getCharge_mAh(), 4);
+    stream->println(F(" mAh"));
+}
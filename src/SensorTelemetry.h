@@ -0,0 +1,108 @@
+/*
+ *SensorTelemetry.h
+ *This file is part of the EnviroDIY modular sensors library for Arduino
+ *
+ *Initial library developement done by Sara Damiano (sdamiano@stroudcenter.org).
+ *
+ *This file is for the timing and energy telemetry kept on a sensor.  Attaching
+ *a SensorTelemetry object to a sensor records, for each update cycle:
+ *  - how long the sensor was powered
+ *  - how long it sat powered past its warm-up time before being woken
+ *  - how long it sat awake past its stabilization time before measuring
+ *  - how many measurements it took, and how many failed
+ *  - how much time was spent on the measurements that failed
+ *With the current the sensor draws while powered, this also gives an estimate
+ *of the charge used by the sensor in each cycle.
+ *
+ *Any of these can be put into an otherwise unused result number of the sensor
+ *so that a Variable attached there will log it, or printed in testing mode.
+ *
+ *For a sensor whose power is not controlled by this library, the "powered"
+ *time runs from when the sensor would have been powered up until its last
+ *measurement finished.
+*/
+
+// Header Guards
+#ifndef SensorTelemetry_h
+#define SensorTelemetry_h
+
+// Debugging Statement
+// #define MS_SENSORTELEMETRY_DEBUG
+
+#ifdef MS_SENSORTELEMETRY_DEBUG
+#define MS_DEBUGGING_STD "SensorTelemetry"
+#endif
+
+// Included Dependencies
+#include "ModSensorDebugger.h"
+#undef MS_DEBUGGING_STD
+#include "SensorBase.h"
+
+// The items of telemetry that can be reported
+typedef enum sensorTelemetry_t
+{
+    TELEM_POWER_ON_MS = 0,
+    TELEM_WARM_UP_SLACK_MS,
+    TELEM_STABILIZATION_SLACK_MS,
+    TELEM_MEASUREMENT_COUNT,
+    TELEM_FAILED_COUNT,
+    TELEM_FAILED_MS,
+    TELEM_CHARGE_MAH
+} sensorTelemetry_t;
+
+
+class SensorTelemetry
+{
+public:
+    SensorTelemetry(float currentDraw_mA = 0);
+    ~SensorTelemetry();
+
+    // This sets the current the sensor draws while it is powered
+    void setCurrentDraw(float currentDraw_mA);
+    float getCurrentDraw(void){return _currentDraw_mA;}
+
+    // This puts an item of telemetry into an otherwise unused result number
+    // of the sensor, so a Variable attached to the sensor with that result
+    // number will report it.  The result number must be at or beyond the
+    // number of values the sensor returns and less than MAX_NUMBER_VARS.
+    bool addDiagnosticResult(sensorTelemetry_t item, uint8_t resultVarNum);
+
+    // These are called by the sensor as it is powered, woken and measured
+    void powerOn(uint32_t now);
+    void powerOff(uint32_t now);
+    void woke(uint32_t now, uint32_t warmUpTime_ms);
+    void measurementStarted(uint32_t now, uint32_t millisSensorActivated,
+                            uint32_t stabilizationTime_ms);
+    void measurementFinished(uint32_t now, bool success);
+    // This clears the measurement counts; the power and wake times are kept
+    // because the sensor may already be powered and awake when it is cleared
+    void clear(void);
+    // This fills in the diagnostic results
+    void fillResults(float values[], uint8_t numReturnedVars);
+
+    // These return the telemetry for the current or most recent cycle
+    float getTelemetry(sensorTelemetry_t item);
+    uint32_t getPowerOnTime(void);
+    float getCharge_mAh(void);
+
+    // This prints out the telemetry on a single line
+    void printTelemetry(Stream *stream);
+
+protected:
+    float _currentDraw_mA;
+
+    uint32_t _millisPowerOn;  // 0 once the power is off
+    uint32_t _powerOnTime_ms;  // set when the power is turned off
+    uint32_t _millisLastActive;
+    uint32_t _millisMeasurementStarted;
+    uint32_t _warmUpSlack_ms;
+    uint32_t _stabilizationSlack_ms;
+    uint32_t _failedTime_ms;
+    uint8_t _measurementCount;
+    uint8_t _failedCount;
+
+    // For each result number, the item it reports; 0xFF for none
+    uint8_t _diagnosticItem[MAX_NUMBER_VARS];
+};
+
+#endif  // Header Guard
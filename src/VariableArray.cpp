@@ -8,15 +8,22 @@
 */
 
 #include "VariableArray.h"
+#include "SensorTelemetry.h"
 
 
 // Constructors
-VariableArray::VariableArray(){}
+VariableArray::VariableArray()
+{
+    _maxCalculationDepth = 0;
+    _valueStore = NULL;
+}
 VariableArray::VariableArray(uint8_t variableCount, Variable *variableList[])
   : arrayOfVars(variableList), _variableCount(variableCount)
 {
     _maxSamplestoAverage = countMaxToAverage();
     _sensorCount = getSensorCount();
+    _maxCalculationDepth = 0;
+    _valueStore = NULL;
 }
 // Destructor
 VariableArray::~VariableArray(){}
@@ -30,12 +37,14 @@ void VariableArray::begin(uint8_t variableCount, Variable *variableList[])
     _maxSamplestoAverage = countMaxToAverage();
     _sensorCount = getSensorCount();
     checkVariableUUIDs();
+    sortCalculations();
 }
 void VariableArray::begin()
 {
     _maxSamplestoAverage = countMaxToAverage();
     _sensorCount = getSensorCount();
     checkVariableUUIDs();
+    sortCalculations();
 }
 
 // This counts and returns the number of calculated variables
@@ -170,15 +179,50 @@ bool VariableArray::setupSensors(void)
 // a calculated variable will never be marked as the last variable from a sensor.
 void VariableArray::sensorsPowerUp(void)
 {
-    MS_DBG(F("Powering up sensors..."));
-    for (uint8_t i = 0; i < _variableCount; i++)
+    // Without a current limit, everything can be switched on at once
+    if (PowerRail::getCurrentLimit() <= 0)
     {
-        if (isLastVarFromSensor(i)) // Skip non-unique sensors
+        MS_DBG(F("Powering up sensors..."));
+        for (uint8_t i = 0; i < _variableCount; i++)
         {
-            MS_DBG(F("    Powering up"), arrayOfVars[i]->getParentSensorNameAndLocation());
+            if (isLastVarFromSensor(i)) // Skip non-unique sensors
+            {
+                MS_DBG(F("    Powering up"), arrayOfVars[i]->getParentSensorNameAndLocation());
+
+                arrayOfVars[i]->parentSensor->powerUp();
+            }
+        }
+        return;
+    }
 
-            arrayOfVars[i]->parentSensor->powerUp();
+    MS_DBG(F("Powering up sensors in sequence within"), PowerRail::getCurrentLimit(), F("mA..."));
+    // Order the sensors by warm-up time, longest first, so the longest waits
+    // overlap the time spent waiting for other rails' inrush to pass
+    uint8_t powerUpOrder[_variableCount];
+    uint8_t nSensors = 0;
+    for (uint8_t i = 0; i < _variableCount; i++)
+    {
+        if (!isLastVarFromSensor(i)) continue;
+        uint32_t warmUp = arrayOfVars[i]->parentSensor->getWarmUpTime();
+        uint8_t j = nSensors;
+        while (j > 0 && arrayOfVars[powerUpOrder[j - 1]]->parentSensor->getWarmUpTime() < warmUp)
+        {
+            powerUpOrder[j] = powerUpOrder[j - 1];
+            j--;
         }
+        powerUpOrder[j] = i;
+        nSensors++;
+    }
+
+    // Switch each on in turn, waiting until its rail fits under the limit
+    for (uint8_t k = 0; k < nSensors; k++)
+    {
+        Sensor *sensor = arrayOfVars[powerUpOrder[k]]->parentSensor;
+        PowerRail *rail = sensor->getPowerRail();
+        if (rail != NULL) {while (!rail->canPowerUp()){}}
+
+        MS_DBG(F("    Powering up"), sensor->getSensorNameAndLocation());
+        sensor->powerUp();
     }
 }
 
@@ -302,11 +346,14 @@ void VariableArray::sensorsPowerDown(void)
 // take advantage of the ability of sensors to be measuring concurrently.
 // NOTE:  Calculated variables will always be skipped in this process because
 // a calculated variable will never be marked as the last variable from a sensor.
-bool VariableArray::updateAllSensors(void)
+bool VariableArray::updateAllSensors(uint32_t cycleEpochTime)
 {
     bool success = true;
     uint8_t nSensorsCompleted = 0;
 
+    // Mark all of the stored values as out of date
+    if (_valueStore != NULL) _valueStore->clear();
+
     #ifdef MS_VARIABLEARRAY_DEBUG_DEEP
     bool deepDebugTiming = true;
     #else
@@ -441,6 +488,7 @@ bool VariableArray::updateAllSensors(void)
                               arrayOfVars[i]->getParentSensorNameAndLocation(), F("..."));
 
                         bool sensorSuccess_result = arrayOfVars[i]->parentSensor->addSingleMeasurementResult();
+                        arrayOfVars[i]->parentSensor->recordMeasurementResult(sensorSuccess_result);
                         success &= sensorSuccess_result;
                         nMeasurementsCompleted[i] += 1;  // increment the number of measurements that sensor has completed
 
@@ -453,6 +501,17 @@ bool VariableArray::updateAllSensors(void)
                        //             nMeasurementsCompleted[i]);
                        // }
                         else {MS_DBG(F("   ... Failed! <<---"), i, '.', nMeasurementsCompleted[i]);}
+
+                        // If the readings have settled, skip the rest of the
+                        // measurements for this sensor
+                        if (nMeasurementsCompleted[i] < nMeasurementsToAverage[i] &&
+                            arrayOfVars[i]->parentSensor->hasConverged())
+                        {
+                            MS_DBG(i, F("--->>"), arrayOfVars[i]->getParentSensorNameAndLocation(),
+                                   F("converged after"), nMeasurementsCompleted[i],
+                                   F("measurements. <<---"), i);
+                            nMeasurementsCompleted[i] = nMeasurementsToAverage[i];
+                        }
                     }
 
                 }
@@ -480,8 +539,10 @@ bool VariableArray::updateAllSensors(void)
             arrayOfVars[i]->parentSensor->averageMeasurements();
             // MS_DBG(F("--- Notifying variables from"), arrayOfVars[i]->getParentSensorNameAndLocation(), F("---"));
             arrayOfVars[i]->parentSensor->notifyVariables();
+            storeSensorValues(i);
         }
     }
+    calculateVariables(cycleEpochTime);
     MS_DBG(F("... Complete. <<-----"));
 
     return success;
@@ -490,11 +551,14 @@ bool VariableArray::updateAllSensors(void)
 
 // This function is an even more complete version of the updateAllSensors
 // function - it handles power up/down and wake/sleep.
-bool VariableArray::completeUpdate(void)
+bool VariableArray::completeUpdate(uint32_t cycleEpochTime)
 {
     bool success = true;
     uint8_t nSensorsCompleted = 0;
 
+    // Mark all of the stored values as out of date
+    if (_valueStore != NULL) _valueStore->clear();
+
     #ifdef MS_VARIABLEARRAY_DEBUG_DEEP
     bool deepDebugTiming = true;
     #else
@@ -530,74 +594,6 @@ bool VariableArray::completeUpdate(void)
         else nMeasurementsToAverage[i] = 0;
     }
 
-    // Create an array of the power pins
-    MS_DBG(F("Creating an array of the power pins.."));
-    int8_t powerPins[_variableCount];
-    for (uint8_t i = 0; i < _variableCount; i++)
-    {
-        if (lastSensorVariable[i])
-        {
-            powerPins[i] = arrayOfVars[i]->parentSensor->getPowerPin();
-        }
-        else powerPins[i] = 0;
-    }
-
-    // Create an array of the last variable on each power pin
-    MS_DBG(F("Creating arrays of the power pin locations.."));
-    bool lastPinVariable[_variableCount];
-    for (uint8_t i = 0; i < _variableCount; i++)
-    {
-        lastPinVariable[i] = 1;
-    }
-    // Create an array containing the index of the power pin in the powerPins array
-    int8_t powerPinIndex[_variableCount];
-    for (uint8_t i = 0; i < _variableCount; i++)
-    {
-        powerPinIndex[i] = 0;
-    }
-    // Create an array to tell us how many measurements must be taken
-    // before all the sensors attached to a power pin are done
-    uint8_t nMeasurementsOnPin[_variableCount];
-    for (uint8_t i = 0; i < _variableCount; i++)
-    {
-        nMeasurementsOnPin[i] = nMeasurementsToAverage[i];
-    }
-    // Now correctly populate the previous three arrays
-    for (uint8_t i = 0; i < _variableCount; i++)
-    {
-        for (uint8_t j = i + 1; j < _variableCount; j++)
-        {
-            if (!lastSensorVariable[i])
-            {
-                lastPinVariable[i] = 0;
-                // MS_DBG(i, F("isn't the last variable on power pin because not last on sensor."));
-            }
-            else if (powerPins[i] == powerPins[j])
-            {
-                lastPinVariable[i] = 0;
-                // MS_DBG(i, F("isn't the last variable on power pin, matches"), j);
-            }
-            i++;
-        }
-    }
-    for (uint8_t i = 0; i < _variableCount; i++)
-    {
-        if (lastPinVariable[i])
-        {
-            powerPinIndex[i] = i;
-            nMeasurementsOnPin[i] = nMeasurementsToAverage[i];
-            for (uint8_t j = 0; j < _variableCount; j++)
-            {
-                if (powerPins[j] == powerPins[i] && i != j)
-                {
-                    powerPinIndex[j] = i;
-                    nMeasurementsOnPin[i] += nMeasurementsToAverage[j];
-                    nMeasurementsOnPin[j] = 0;
-                }
-            }
-        }
-    }
-
     // This is just for debugging
     #ifdef MS_VARIABLEARRAY_DEBUG_DEEP
     uint8_t arrayPositions[_variableCount];
@@ -620,23 +616,8 @@ bool VariableArray::completeUpdate(void)
     prettyPrintArray(lastSensorVariable);
     MS_DEEP_DBG(F("nMeasurementsToAverage:\t\t"));
     prettyPrintArray(nMeasurementsToAverage);
-    MS_DEEP_DBG(F("powerPins:\t\t\t"));
-    prettyPrintArray(powerPins);
-    MS_DEEP_DBG(F("lastPinVariable:\t\t"));
-    prettyPrintArray(lastPinVariable);
-    MS_DEEP_DBG(F("nMeasurementsOnPin:\t\t"));
-    prettyPrintArray(nMeasurementsOnPin);
-    MS_DEEP_DBG(F("powerPinIndex:\t\t\t"));
-    prettyPrintArray(powerPinIndex);
     #endif
 
-    // Another array for the number of measurements already completed per power pin
-    uint8_t nCompletedOnPin[_variableCount];
-    for (uint8_t i = 0; i < _variableCount; i++)
-    {
-        nCompletedOnPin[i] = 0;
-    }
-
     // Clear the initial variable arrays
     MS_DBG(F("----->> Clearing all results arrays before taking new measurements. ..."));
     for (uint8_t i = 0; i < _variableCount; i++)
@@ -711,8 +692,6 @@ bool VariableArray::completeUpdate(void)
                     // Set the number of measurements already equal to whatever total
                     // number requested to ensure the sensor is skipped in further loops.
                     nMeasurementsCompleted[i] = nMeasurementsToAverage[i];
-                    // increment the number of measurements that the power pin has completed
-                    nCompletedOnPin[powerPinIndex[i]] += nMeasurementsToAverage[i];
                 }
 
                 // If the sensor was successfully awoken/activated...
@@ -751,9 +730,9 @@ bool VariableArray::completeUpdate(void)
                                arrayOfVars[i]->getParentSensorNameAndLocation(), F("..."));
 
                         bool sensorSuccess_result = arrayOfVars[i]->parentSensor->addSingleMeasurementResult();
+                        arrayOfVars[i]->parentSensor->recordMeasurementResult(sensorSuccess_result);
                         success &= sensorSuccess_result;
                         nMeasurementsCompleted[i] += 1;  // increment the number of measurements that sensor has completed
-                        nCompletedOnPin[powerPinIndex[i]] += 1;  // increment the number of measurements that the power pin has completed
 
                         if (sensorSuccess_result) {MS_DBG(F("   ... Success. <<---"), i, '.', nMeasurementsCompleted[i]);}
                        //  if (sensorSuccess_result)
@@ -764,6 +743,17 @@ bool VariableArray::completeUpdate(void)
                        //             nMeasurementsCompleted[i]);
                        // }
                         else {MS_DBG(F("   ... Failed! <<---"), i, '.', nMeasurementsCompleted[i]);}
+
+                        // If the readings have settled, skip the rest of the
+                        // measurements for this sensor
+                        if (nMeasurementsCompleted[i] < nMeasurementsToAverage[i] &&
+                            arrayOfVars[i]->parentSensor->hasConverged())
+                        {
+                            MS_DBG(i, F("--->>"), arrayOfVars[i]->getParentSensorNameAndLocation(),
+                                   F("converged after"), nMeasurementsCompleted[i],
+                                   F("measurements. <<---"), i);
+                            nMeasurementsCompleted[i] = nMeasurementsToAverage[i];
+                        }
                     }
 
                 }
@@ -782,20 +772,11 @@ bool VariableArray::completeUpdate(void)
                     if (sensorSuccess_sleep) {MS_DBG(F("   ... Success. <<---"), i);}
                     else {MS_DBG(F("   ... Failed! <<---"), i);}
 
-                    // Now cut the power, if ready, to this sensors and all that share the pin
-                    if (nCompletedOnPin[powerPinIndex[i]] == nMeasurementsOnPin[powerPinIndex[i]])
-                    {
-                        for (uint8_t k = 0; k < _variableCount; k++)
-                        {
-                            if (powerPinIndex[k] == powerPinIndex[i] && lastSensorVariable[k] )
-                            {
-                                arrayOfVars[k]->parentSensor->powerDown();
-                                MS_DBG(k, F("--->>"),
-                                       arrayOfVars[k]->getParentSensorNameAndLocation(),
-                                       F("powered down. <<---"), k);
-                            }
-                        }
-                    }
+                    // Let go of the power; the power rail stays on until every
+                    // sensor that shares the pin is finished
+                    arrayOfVars[i]->parentSensor->powerDown();
+                    MS_DBG(i, F("--->>"), arrayOfVars[i]->getParentSensorNameAndLocation(),
+                           F("powered down. <<---"), i);
 
                     nSensorsCompleted++;  // mark the whole sensor as done
                     MS_DBG(F("*****---"), nSensorsCompleted, F("sensors now complete ---*****"));
@@ -816,8 +797,10 @@ bool VariableArray::completeUpdate(void)
             MS_DBG(F("--- Notifying variables from"),
                    arrayOfVars[i]->getParentSensorNameAndLocation(), F("---"));
             arrayOfVars[i]->parentSensor->notifyVariables();
+            storeSensorValues(i);
         }
     }
+    calculateVariables(cycleEpochTime);
     MS_DBG(F("... Complete. <<-----"));
 
     return success;
@@ -863,6 +846,147 @@ void VariableArray::printSensorData(Stream *stream)
 }
 
 
+// This starts a new update cycle and calculates all of the calculated
+// variables, shallowest first, so every input is ready before it is used.
+void VariableArray::calculateVariables(uint32_t cycleEpochTime)
+{
+    Variable::startUpdateCycle(cycleEpochTime);
+    for (uint8_t depth = 1; depth <= _maxCalculationDepth; depth++)
+    {
+        for (uint8_t i = 0; i < _variableCount; i++)
+        {
+            if (arrayOfVars[i]->isCalculated &&
+                arrayOfVars[i]->getCalculationDepth() == depth)
+            {
+                arrayOfVars[i]->getValue();
+            }
+        }
+    }
+
+    if (_valueStore == NULL) return;
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < _variableCount; i++)
+    {
+        if (arrayOfVars[i]->isCalculated)
+            _valueStore->setValue(i, arrayOfVars[i]->getValue(), VALUE_FLAG_CALCULATED, now);
+    }
+}
+
+
+void VariableArray::setValueStore(VariableValueStore& store)
+{
+    _valueStore = &store;
+    if (store.getCapacity() < _variableCount)
+    {
+        MS_DBG(F("The value store only has room for"), store.getCapacity(),
+               F("of the"), _variableCount, F("variables!"));
+    }
+}
+
+
+float VariableArray::getValue(uint8_t arrayIndex)
+{
+    if (_valueStore != NULL && arrayIndex < _valueStore->getCapacity())
+        return _valueStore->getValue(arrayIndex);
+    return arrayOfVars[arrayIndex]->getValue();
+}
+
+
+String VariableArray::getValueString(uint8_t arrayIndex)
+{
+    if (_valueStore == NULL || arrayIndex >= _valueStore->getCapacity())
+        return arrayOfVars[arrayIndex]->getValueString();
+    return formatValueString(arrayIndex, _valueStore->getValue(arrayIndex));
+}
+
+
+// This formats a value just as Variable::getValueString() does
+String VariableArray::formatValueString(uint8_t arrayIndex, float value)
+{
+    uint8_t decimalResolution = arrayOfVars[arrayIndex]->getResolution();
+    if (decimalResolution == 0)
+    {
+        int16_t val = int(value);
+        return String(val);
+    }
+    else return String(value, decimalResolution);
+}
+
+
+// This copies the values of every variable from the sensor at an index into
+// the store, once the sensor has notified them
+void VariableArray::storeSensorValues(uint8_t arrayIndex)
+{
+    if (_valueStore == NULL) return;
+    Sensor *sensor = arrayOfVars[arrayIndex]->parentSensor;
+    uint8_t flags = bitRead(sensor->getStatus(), 7) ? VALUE_FLAG_SENSOR_ERROR : 0;
+    uint32_t now = millis();
+    for (uint8_t j = 0; j < _variableCount; j++)
+    {
+        if (!arrayOfVars[j]->isCalculated && arrayOfVars[j]->parentSensor == sensor)
+            _valueStore->setValue(j, arrayOfVars[j]->getValue(), flags, now);
+    }
+}
+
+
+// This prints out the timing and energy telemetry of each sensor that keeps it
+void VariableArray::printSensorTelemetry(Stream *stream)
+{
+    for (uint8_t i = 0; i < _variableCount; i++)
+    {
+        if (!isLastVarFromSensor(i)) continue;
+        SensorTelemetry *telemetry = arrayOfVars[i]->parentSensor->getTelemetry();
+        if (telemetry == NULL) continue;
+        stream->print(arrayOfVars[i]->getParentSensorNameAndLocation());
+        stream->print(F(" was "));
+        telemetry->printTelemetry(stream);
+    }
+}
+
+
+// This ranks each calculated variable one deeper than its deepest input, which
+// sorts the calculations so that they can be run in order of depth.
+// Calculated variables that don't list their inputs are ranked 1.
+void VariableArray::sortCalculations(void)
+{
+    _maxCalculationDepth = 0;
+    for (uint8_t i = 0; i < _variableCount; i++)
+    {
+        arrayOfVars[i]->setCalculationDepth(arrayOfVars[i]->isCalculated ? 1 : 0);
+    }
+
+    // Each pass can only push the depth one step further down a chain, so
+    // any chain longer than the number of variables must be a loop
+    bool changed = true;
+    for (uint8_t pass = 0; changed && pass <= _variableCount; pass++)
+    {
+        changed = false;
+        for (uint8_t i = 0; i < _variableCount; i++)
+        {
+            if (!arrayOfVars[i]->isCalculated) continue;
+            uint8_t depth = 1;
+            for (uint8_t j = 0; j < arrayOfVars[i]->getInputCount(); j++)
+            {
+                Variable *input = arrayOfVars[i]->getInput(j);
+                if (input != NULL && input->getCalculationDepth() >= depth)
+                    depth = input->getCalculationDepth() + 1;
+            }
+            if (depth != arrayOfVars[i]->getCalculationDepth())
+            {
+                arrayOfVars[i]->setCalculationDepth(depth);
+                changed = true;
+            }
+            if (depth > _maxCalculationDepth) _maxCalculationDepth = depth;
+        }
+    }
+    if (changed)
+    {
+        MS_DBG(F("The calculated variables depend on each other in a loop!"));
+    }
+    MS_DBG(F("Calculated variables are up to"), _maxCalculationDepth, F("calculations deep."));
+}
+
+
 // Check for unique sensors
 bool VariableArray::isLastVarFromSensor(int arrayIndex)
 {
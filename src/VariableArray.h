@@ -29,6 +29,7 @@
 #undef MS_DEBUGGING_DEEP
 #include "VariableBase.h"
 #include "SensorBase.h"
+#include "VariableValueStore.h"
 
 // Defines another class for interfacing with a list of pointers to sensor instances
 class VariableArray
@@ -80,23 +81,49 @@ public:
     void sensorsPowerDown(void);
 
     // This function updates the values for any connected sensors.
-    bool updateAllSensors(void);
+    // The time of the update, in epoch seconds, is needed for any stateful
+    // calculated variables to be calculated; see VariableBase.h.
+    bool updateAllSensors(uint32_t cycleEpochTime = 0);
 
     // This function powers, wakes, updates values, sleeps and powers down.
-    bool completeUpdate(void);
+    bool completeUpdate(uint32_t cycleEpochTime = 0);
+
+    // This attaches a store for the latest values of all of the variables
+    // See VariableValueStore.h.  It must have room for every variable.
+    void setValueStore(VariableValueStore& store);
+    VariableValueStore *getValueStore(void){return _valueStore;}
+    // These return the latest value of a variable in the array, from the
+    // store if there is one
+    float getValue(uint8_t arrayIndex);
+    String getValueString(uint8_t arrayIndex);
+    // This formats any value with the resolution of a variable in the array
+    String formatValueString(uint8_t arrayIndex, float value);
+
+    // This starts a new update cycle and calculates all of the calculated
+    // variables, each after the variables it is calculated from.  This is
+    // run at the end of each update.
+    void calculateVariables(uint32_t cycleEpochTime = 0);
 
     // This function prints out the results for any connected sensors to a stream
     void printSensorData(Stream *stream = &Serial);
 
+    // This prints out the timing and energy telemetry of each sensor that
+    // has telemetry attached
+    void printSensorTelemetry(Stream *stream = &Serial);
+
 protected:
     uint8_t _variableCount;
     uint8_t _sensorCount;
     uint8_t _maxSamplestoAverage;
+    uint8_t _maxCalculationDepth;
+    VariableValueStore *_valueStore;
 
 private:
     bool isLastVarFromSensor(int arrayIndex);
     uint8_t countMaxToAverage(void);
     bool checkVariableUUIDs(void);
+    void sortCalculations(void);
+    void storeSensorValues(uint8_t arrayIndex);
 
 #ifdef MS_VARIABLEARRAY_DEBUG_DEEP
     template<typename T>
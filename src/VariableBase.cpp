@@ -10,6 +10,15 @@
 #include "VariableBase.h"
 #include "SensorBase.h"
 
+// This reads a string pointer from the flash metadata table
+#if defined(__AVR__)
+#define readMetadataString(field) \
+    String((const __FlashStringHelper *)pgm_read_word(&_metadata->field))
+#else
+#define readMetadataString(field) \
+    String((const __FlashStringHelper *)_metadata->field)
+#endif
+
 // ============================================================================
 //  The class and functions for interfacing with a specific variable.
 // ============================================================================
@@ -33,11 +42,14 @@ Variable::Variable(Sensor *parentSense,
 
     isCalculated = false;
     _calcFxn = NULL;
+    _statefulCalcFxn = NULL;
     attachSensor(parentSense);
 
     // When we create the variable, we also want to initialize it with a current
     // value of -9999 (ie, a bad result).
     _currentValue = -9999;
+    initCalculation();
+    _metadata = NULL;
 
     // MS_DBG(F("Measured Variable object created"));
 }
@@ -56,16 +68,44 @@ Variable::Variable(const uint8_t sensorVarNum,
 
     isCalculated = false;
     _calcFxn = NULL;
+    _statefulCalcFxn = NULL;
     parentSensor = NULL;
 
     // When we create the variable, we also want to initialize it with a current
     // value of -9999 (ie, a bad result).
     _currentValue = -9999;
+    initCalculation();
+    _metadata = NULL;
 
     // MS_DBG(F("Measured Variable object created"));
 }
 
 
+// The constructor for a measured variable whose metadata is in flash
+Variable::Variable(Sensor *parentSense,
+                   const uint8_t sensorVarNum,
+                   const variableMetadata_t *metadata)
+  : _sensorVarNum(sensorVarNum)
+{
+    _varName = NULL;
+    _varUnit = NULL;
+    _varCode = NULL;
+    _uuid = NULL;
+    _decimalResolution = 0;
+    setMetadata(metadata);
+
+    isCalculated = false;
+    _calcFxn = NULL;
+    _statefulCalcFxn = NULL;
+    attachSensor(parentSense);
+
+    // When we create the variable, we also want to initialize it with a current
+    // value of -9999 (ie, a bad result).
+    _currentValue = -9999;
+    initCalculation();
+}
+
+
 // The constructor for a calculated variable  - that is, one whose value is
 // calculated by the calcFxn which returns a float.
 Variable::Variable(float (*calcFxn)(),
@@ -89,6 +129,8 @@ Variable::Variable(float (*calcFxn)(),
     // When we create the variable, we also want to initialize it with a current
     // value of -9999 (ie, a bad result).
     _currentValue = -9999;
+    initCalculation();
+    _metadata = NULL;
 
     // MS_DBG(F("Calculated Variable object created"));
 }
@@ -112,6 +154,79 @@ Variable::Variable(float (*calcFxn)(),
     // When we create the variable, we also want to initialize it with a current
     // value of -9999 (ie, a bad result).
     _currentValue = -9999;
+    initCalculation();
+    _metadata = NULL;
+
+    // MS_DBG(F("Calculated Variable object created"));
+}
+Variable::Variable(float (*calcFxn)(),
+                   const variableMetadata_t *metadata)
+  : _sensorVarNum(0)
+{
+    _varName = NULL;
+    _varUnit = NULL;
+    _varCode = NULL;
+    _uuid = NULL;
+    _decimalResolution = 0;
+    setMetadata(metadata);
+
+    isCalculated = true;
+    setCalculation(calcFxn);
+    parentSensor = NULL;
+
+    // When we create the variable, we also want to initialize it with a current
+    // value of -9999 (ie, a bad result).
+    _currentValue = -9999;
+    initCalculation();
+}
+Variable::Variable(float (*statefulCalcFxn)(float previousValue, uint32_t elapsed_ms),
+                   uint8_t decimalResolution,
+                   const char *varName,
+                   const char *varUnit,
+                   const char *varCode,
+                   const char *uuid)
+  : _sensorVarNum(0)
+{
+    setVarUUID(uuid);
+    setVarCode(varCode);
+    setVarUnit(varUnit);
+    setVarName(varName);
+    setResolution(decimalResolution);
+
+    isCalculated = true;
+    setCalculation(statefulCalcFxn);
+    parentSensor = NULL;
+
+    // When we create the variable, we also want to initialize it with a current
+    // value of -9999 (ie, a bad result).
+    _currentValue = -9999;
+    initCalculation();
+    _metadata = NULL;
+
+    // MS_DBG(F("Calculated Variable object created"));
+}
+Variable::Variable(float (*statefulCalcFxn)(float previousValue, uint32_t elapsed_ms),
+                   uint8_t decimalResolution,
+                   const char *varName,
+                   const char *varUnit,
+                   const char *varCode)
+  : _sensorVarNum(0)
+{
+    _uuid = NULL;
+    setVarCode(varCode);
+    setVarUnit(varUnit);
+    setVarName(varName);
+    setResolution(decimalResolution);
+
+    isCalculated = true;
+    setCalculation(statefulCalcFxn);
+    parentSensor = NULL;
+
+    // When we create the variable, we also want to initialize it with a current
+    // value of -9999 (ie, a bad result).
+    _currentValue = -9999;
+    initCalculation();
+    _metadata = NULL;
 
     // MS_DBG(F("Calculated Variable object created"));
 }
@@ -126,11 +241,14 @@ Variable::Variable()
 
     isCalculated = true;
     _calcFxn = NULL;
+    _statefulCalcFxn = NULL;
     parentSensor = NULL;
 
     // When we create the variable, we also want to initialize it with a current
     // value of -9999 (ie, a bad result).
     _currentValue = -9999;
+    initCalculation();
+    _metadata = NULL;
 
     // MS_DBG(F("Calculated Variable object created"));
 }
@@ -140,6 +258,21 @@ Variable::Variable()
 Variable::~Variable(){}
 
 
+uint16_t Variable::_updateCycle = 0;
+uint32_t Variable::_cycleEpochTime = 0;
+
+
+// This clears the calculation inputs and cache
+void Variable::initCalculation(void)
+{
+    _inputs = NULL;
+    _inputCount = 0;
+    _calculationDepth = 0;
+    _valueCycle = 0;
+    _epochCalculated = 0;
+}
+
+
 // This does all of the setup that can't happen in the constructors
 // That is, anything that is dependent on another object having been created
 // first or anything that requires the actual processor/MCU to do something.
@@ -263,9 +396,35 @@ void Variable::setCalculation(float (*calcFxn)())
     {
         // MS_DBG(F("Calculation function set"));
         _calcFxn = calcFxn;
+        _statefulCalcFxn = NULL;
     }
     // else MS_DBG(F("This is a measured variable.  It cannot have a calculation function!"));
 }
+void Variable::setCalculation(float (*statefulCalcFxn)(float previousValue, uint32_t elapsed_ms))
+{
+    if (isCalculated)
+    {
+        _statefulCalcFxn = statefulCalcFxn;
+        _calcFxn = NULL;
+    }
+}
+
+
+// This lists the variables a calculated variable is calculated from
+void Variable::setInputs(Variable *inputs[], uint8_t inputCount)
+{
+    _inputs = inputs;
+    _inputCount = inputs == NULL ? 0 : inputCount;
+}
+
+
+void Variable::startUpdateCycle(uint32_t cycleEpochTime)
+{
+    _cycleEpochTime = cycleEpochTime;
+    _updateCycle++;
+    // Skip 0, which means no cycle, when the counter rolls over
+    if (_updateCycle == 0) _updateCycle = 1;
+}
 
 
 // This sets up the variable (generally attaching it to its parent)
@@ -277,7 +436,11 @@ void Variable::setCalculation(float (*calcFxn)())
 
 
 // This gets/sets the variable's resolution for value strings
-uint8_t Variable::getResolution(void){return _decimalResolution;}
+uint8_t Variable::getResolution(void)
+{
+    if (_metadata != NULL) return pgm_read_byte(&_metadata->decimalResolution);
+    return _decimalResolution;
+}
 void Variable::setResolution(uint8_t decimalResolution)
 {
     _decimalResolution = decimalResolution;
@@ -285,7 +448,11 @@ void Variable::setResolution(uint8_t decimalResolution)
 }
 
 // This gets/sets the variable's name using http://vocabulary.odm2.org/variablename/
-String Variable::getVarName(void){return _varName;}
+String Variable::getVarName(void)
+{
+    if (_metadata != NULL) return readMetadataString(varName);
+    return _varName;
+}
 void Variable::setVarName(const char *varName)
 {
     _varName = varName;
@@ -293,7 +460,11 @@ void Variable::setVarName(const char *varName)
 }
 
 // This gets/sets the variable's unit using http://vocabulary.odm2.org/units/
-String Variable::getVarUnit(void){return _varUnit;}
+String Variable::getVarUnit(void)
+{
+    if (_metadata != NULL) return readMetadataString(varUnit);
+    return _varUnit;
+}
 void Variable::setVarUnit(const char *varUnit)
 {
     _varUnit = varUnit;
@@ -301,7 +472,11 @@ void Variable::setVarUnit(const char *varUnit)
 }
 
 // This returns a customized code for the variable
-String Variable::getVarCode(void){return _varCode;}
+String Variable::getVarCode(void)
+{
+    if (_metadata != NULL) return readMetadataString(varCode);
+    return _varCode;
+}
 // This sets the variable code to a new custom value
 void Variable::setVarCode(const char *varCode)
 {
@@ -310,7 +485,11 @@ void Variable::setVarCode(const char *varCode)
 }
 
 // This returns the variable UUID, if one has been assigned
-String Variable::getVarUUID(void){return _uuid;}
+String Variable::getVarUUID(void)
+{
+    if (_metadata != NULL) return readMetadataString(uuid);
+    return _uuid;
+}
 // This sets the UUID
 void Variable::setVarUUID(const char *uuid)
 {
@@ -318,30 +497,41 @@ void Variable::setVarUUID(const char *uuid)
     // if (strlen(_uuid) == 0) MS_DBG(F("No UUID assigned"));
     // else MS_DBG(F("Variable UUID is"), _uuid);
 }
+// This replaces the metadata with a table in flash
+void Variable::setMetadata(const variableMetadata_t *metadata)
+{
+    _metadata = metadata;
+}
+
+
 // This checks that the UUID is properly formatted
 bool Variable::checkUUIDFormat(void)
 {
+    // Copy the UUID, in case it is in flash
+    String uuidString = getVarUUID();
+    const char *uuidChars = uuidString.c_str();
+
     // If no UUID, move on
-    if (strlen(_uuid) == 0)
+    if (strlen(uuidChars) == 0)
     {
         // MS_DBG(F("No UUID assigned to"), getVarCode());
         return true;
     }
 
-    // MS_DBG(F("Variable UUID for"), getVarCode(), F("is"), _uuid);
+    // MS_DBG(F("Variable UUID for"), getVarCode(), F("is"), uuidChars);
     // Should be 36 characters long with dashes
-    if (strlen(_uuid) != 36)
+    if (strlen(uuidChars) != 36)
     {
-        MS_DBG(F("UUID length for"), getVarCode(), '(', _uuid, ')',
-               F("is incorrect, should be 36 characters not"), strlen(_uuid));
+        MS_DBG(F("UUID length for"), getVarCode(), '(', uuidChars, ')',
+               F("is incorrect, should be 36 characters not"), strlen(uuidChars));
         return false;
     }
 
     // "12345678-abcd-1234-ef00-1234567890ab"
     const char * acceptableChars = "0123456789abcdefABCDEF-";
-    if (_uuid[8] != '-' || _uuid[13] != '-' || _uuid[18] != '-' || _uuid[23] != '-')
+    if (uuidChars[8] != '-' || uuidChars[13] != '-' || uuidChars[18] != '-' || uuidChars[23] != '-')
     {
-        MS_DBG(F("UUID format for"), getVarCode(), '(', _uuid, ')',
+        MS_DBG(F("UUID format for"), getVarCode(), '(', uuidChars, ')',
                F("is incorrect, expecting dashes at positions 9, 14, 19, and 24."));
         return false;
     }
@@ -350,7 +540,7 @@ bool Variable::checkUUIDFormat(void)
         bool isAcceptable = false;
         for (uint8_t j = 0; !isAcceptable && j < 23; j++)
         {
-            if (_uuid[i] == acceptableChars[j])
+            if (uuidChars[i] == acceptableChars[j])
             {
                 isAcceptable = true;
                 j = 23;  // Stop the inner loop
@@ -358,8 +548,8 @@ bool Variable::checkUUIDFormat(void)
         }
         if (!isAcceptable)
         {
-            MS_DBG(F("UUID for"), getVarCode(), '(', _uuid, ')',
-                   F("has a bad character"), _uuid[i], F("at"), i+1);
+            MS_DBG(F("UUID for"), getVarCode(), '(', uuidChars, ')',
+                   F("has a bad character"), uuidChars[i], F("at"), i+1);
             return false;
         }
     }
@@ -376,7 +566,15 @@ float Variable::getValue(bool updateValue)
         // the calculation because we don't know which sensors those are.
         // Make sure you update the parent sensors manually for a calculated
         // variable!!
-        return _calcFxn();
+        // Only calculate once per update cycle, unless asked to update the
+        // value.  A stateful calculation is only ever run once per cycle, or
+        // it would add to a running total again.
+        if (_updateCycle == 0 || _valueCycle != _updateCycle ||
+            (updateValue && _statefulCalcFxn == NULL))
+        {
+            calculateValue();
+        }
+        return _currentValue;
     }
     else
     {
@@ -386,16 +584,38 @@ float Variable::getValue(bool updateValue)
 }
 
 
+// This runs the calculation and stores the result for the rest of the cycle
+void Variable::calculateValue(void)
+{
+    if (_statefulCalcFxn != NULL)
+    {
+        // Only run in a timed cycle, or every read of the value outside of
+        // one would add to a running total again
+        if (_cycleEpochTime != 0)
+        {
+            // There's no previous value to go on the first time
+            uint32_t elapsed_ms = _epochCalculated == 0 ? 0 :
+                                  (_cycleEpochTime - _epochCalculated)*1000;
+            _currentValue = _statefulCalcFxn(_currentValue, elapsed_ms);
+            _epochCalculated = _cycleEpochTime;
+        }
+    }
+    else if (_calcFxn != NULL) _currentValue = _calcFxn();
+    _valueCycle = _updateCycle;
+}
+
+
 // This returns the current value of the variable as a string
 // with the correct number of significant figures
 String Variable::getValueString(bool updateValue)
 {
     // Need this because otherwise get extra spaces in strings from int
-    if (_decimalResolution == 0)
+    uint8_t decimalResolution = getResolution();
+    if (decimalResolution == 0)
     {
         int16_t val = int(getValue(updateValue));
         return String(val);
     }
     else
-    {return String(getValue(updateValue), _decimalResolution);}
+    {return String(getValue(updateValue), decimalResolution);}
 }
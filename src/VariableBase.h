@@ -5,6 +5,17 @@
  *Initial library developement done by Sara Damiano (sdamiano@stroudcenter.org).
  *
  *This file is for the variable base class.
+ *
+ *A calculated variable is only calculated once per update cycle; every other
+ *request for its value in the same cycle gets the stored result.  A new cycle
+ *is started each time a VariableArray updates its sensors.  Calculated
+ *variables can list the variables they are calculated from so the array can
+ *calculate them in order, inputs first, right after each update.  A "stateful"
+ *calculation is also given its own previous value and the time since it was
+ *last calculated, for running totals or rates of change.  That time comes from
+ *the clock time given for each cycle, because millis() stops while the
+ *processor sleeps.  Stateful calculations are only run in cycles given a time;
+ *otherwise they keep their last value.
 */
 
 // Header Guards
@@ -25,6 +36,28 @@ class Sensor;
 #include "ModSensorDebugger.h"
 #undef MS_DEBUGGING_STD
 
+// The flash-resident metadata of a variable
+// All of the strings must themselves be in flash.
+typedef struct variableMetadata_t
+{
+    const char *varName;
+    const char *varUnit;
+    const char *varCode;
+    const char *uuid;
+    uint8_t decimalResolution;
+} variableMetadata_t;
+
+// This declares a metadata table, and the strings in it, in flash
+// ie:  MS_VARIABLE_METADATA(ds18TempMeta, "temperature", "degreeCelsius", 4,
+//                           "DS18Temp", "12345678-abcd-1234-ef00-1234567890ab");
+#define MS_VARIABLE_METADATA(tableName, varName, varUnit, decimalResolution, varCode, uuid) \
+    const char tableName##_name[] PROGMEM = varName; \
+    const char tableName##_unit[] PROGMEM = varUnit; \
+    const char tableName##_code[] PROGMEM = varCode; \
+    const char tableName##_uuid[] PROGMEM = uuid; \
+    const variableMetadata_t tableName PROGMEM = \
+        {tableName##_name, tableName##_unit, tableName##_code, tableName##_uuid, decimalResolution};
+
 class Variable
 {
 public:
@@ -56,6 +89,27 @@ public:
              const char *varName,
              const char *varUnit,
              const char *varCode);
+    // The constructors for a measured or calculated variable whose metadata is
+    // in a flash table
+    Variable(Sensor *parentSense,
+             const uint8_t sensorVarNum,
+             const variableMetadata_t *metadata);
+    Variable(float (*calcFxn)(),
+             const variableMetadata_t *metadata);
+    // The constructors for a calculated variable whose calculation depends on
+    // its own previous value and the milliseconds since it was calculated,
+    // by the clock times given to the updates
+    Variable(float (*statefulCalcFxn)(float previousValue, uint32_t elapsed_ms),
+             uint8_t decimalResolution,
+             const char *varName,
+             const char *varUnit,
+             const char *varCode,
+             const char *uuid);
+    Variable(float (*statefulCalcFxn)(float previousValue, uint32_t elapsed_ms),
+             uint8_t decimalResolution,
+             const char *varName,
+             const char *varUnit,
+             const char *varCode);
     Variable();
 
     // Destructor
@@ -95,6 +149,23 @@ public:
 
     // This ties a calculated variable to its calculation function
     void setCalculation(float (*calcFxn)());
+    void setCalculation(float (*statefulCalcFxn)(float previousValue, uint32_t elapsed_ms));
+    // This lists the variables a calculated variable is calculated from
+    // The list is not copied; it must stay in place.
+    void setInputs(Variable *inputs[], uint8_t inputCount);
+    uint8_t getInputCount(void){return _inputCount;}
+    Variable *getInput(uint8_t inputNum){return _inputs[inputNum];}
+    // The number of calculations between this variable and the measured
+    // variables it depends on; 0 for a measured variable.  This is set by the
+    // variable array.
+    uint8_t getCalculationDepth(void){return _calculationDepth;}
+    void setCalculationDepth(uint8_t depth){_calculationDepth = depth;}
+
+    // This starts a new update cycle, so every calculated variable will be
+    // calculated again the next time its value is asked for.  The cycle's
+    // time, in epoch seconds, times the stateful calculations; with no time,
+    // they aren't run.
+    static void startUpdateCycle(uint32_t cycleEpochTime = 0);
 
     // This sets up the variable (generally attaching it to its parent)
     // bool setup(void);
@@ -115,8 +186,15 @@ public:
     String getVarUUID(void);
     void setVarUUID(const char *uuid);
     bool checkUUIDFormat(void);
+    // This replaces the name, unit, code, UUID and resolution with those in a
+    // flash table.  Setting any of them again afterwards has no effect.
+    void setMetadata(const variableMetadata_t *metadata);
 
     // This returns the current value of the variable as a float
+    // For a measured variable, updateValue updates the parent sensor first.
+    // For a calculated variable, it recalculates the value even if it was
+    // already calculated this cycle, ie, after updating its sensors by hand.
+    // Stateful calculations are still only run once per cycle.
     float getValue(bool updateValue = false);
     // This returns the current value of the variable as a string with the
     // correct number of significant figures
@@ -129,8 +207,24 @@ public:
 protected:
     float _currentValue;
 
+    // The update cycle the current value was calculated in
+    // Cycle 0 means no cycle has been started and the value is always
+    // recalculated, as it would be for a variable outside of an array.
+    static uint16_t _updateCycle;
+    static uint32_t _cycleEpochTime;
+    uint16_t _valueCycle;
+    // The cycle time a stateful calculation was last run for
+    uint32_t _epochCalculated;
+
 private:
     float (*_calcFxn)(void);
+    float (*_statefulCalcFxn)(float previousValue, uint32_t elapsed_ms);
+    void initCalculation(void);
+    void calculateValue(void);
+
+    Variable **_inputs;
+    uint8_t _inputCount;
+    uint8_t _calculationDepth;
 
     const uint8_t _sensorVarNum;
     uint8_t _decimalResolution;
@@ -139,6 +233,7 @@ private:
     const char *_varUnit;
     const char *_varCode;
     const char *_uuid;
+    const variableMetadata_t *_metadata;
 };
 
 #endif  // Header Guard
@@ -0,0 +1,45 @@
+/*
+ *VariableValueStore.cpp
+ *This file is part of the EnviroDIY modular sensors library for Arduino
+ *
+ *Initial library developement done by Sara Damiano (sdamiano@stroudcenter.org).
+ *
+ *This file is for a contiguous store of the latest values of all of the
+ *variables in a variable array.
+*/
+
+#include "VariableValueStore.h"
+
+
+VariableValueStore::VariableValueStore(float *values, uint8_t *flags,
+                                       uint32_t *timestamps, uint8_t capacity)
+{
+    _values = values;
+    _flags = flags;
+    _timestamps = timestamps;
+    _capacity = capacity;
+    for (uint8_t i = 0; i < _capacity; i++)
+    {
+        _values[i] = -9999;
+        _flags[i] = VALUE_FLAG_BAD | VALUE_FLAG_NOT_UPDATED;
+        _timestamps[i] = 0;
+    }
+}
+VariableValueStore::~VariableValueStore(){}
+
+
+void VariableValueStore::clear(void)
+{
+    for (uint8_t i = 0; i < _capacity; i++) _flags[i] |= VALUE_FLAG_NOT_UPDATED;
+}
+
+
+void VariableValueStore::setValue(uint8_t varNum, float value, uint8_t flags,
+                                  uint32_t timestamp)
+{
+    if (varNum >= _capacity) return;
+    if (value == -9999) flags |= VALUE_FLAG_BAD;
+    _values[varNum] = value;
+    _flags[varNum] = flags;
+    _timestamps[varNum] = timestamp;
+}
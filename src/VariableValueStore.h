@@ -0,0 +1,88 @@
+/*
+ *VariableValueStore.h
+ *This file is part of the EnviroDIY modular sensors library for Arduino
+ *
+ *Initial library developement done by Sara Damiano (sdamiano@stroudcenter.org).
+ *
+ *This file is for a contiguous store of the latest values of all of the
+ *variables in a variable array.  Without a store, every value is fetched
+ *through the variable - and, for a calculated variable, its calculation - each
+ *time a record is printed or published.  With a store attached, the array
+ *copies each value in as its sensor reports it and the records are read
+ *straight from the store, in order.
+ *
+ *Each value is kept with a set of quality flags and the time (in millis) that
+ *it was stored.
+*/
+
+// Header Guards
+#ifndef VariableValueStore_h
+#define VariableValueStore_h
+
+// Debugging Statement
+// #define MS_VARIABLEVALUESTORE_DEBUG
+
+#ifdef MS_VARIABLEVALUESTORE_DEBUG
+#define MS_DEBUGGING_STD "VariableValueStore"
+#endif
+
+// Included Dependencies
+#include "ModSensorDebugger.h"
+#undef MS_DEBUGGING_STD
+
+// The quality flags for a stored value
+#define VALUE_FLAG_BAD 0x01  // The value is -9999
+#define VALUE_FLAG_CALCULATED 0x02  // The value is from a calculated variable
+#define VALUE_FLAG_SENSOR_ERROR 0x04  // The sensor had an error (status bit 7)
+#define VALUE_FLAG_NOT_UPDATED 0x08  // No value has been stored this cycle
+
+
+// The store itself, using space given to it
+// Use the VariableValueBuffer template below to create one with its own space.
+class VariableValueStore
+{
+public:
+    VariableValueStore(float *values, uint8_t *flags, uint32_t *timestamps,
+                       uint8_t capacity);
+    ~VariableValueStore();
+
+    uint8_t getCapacity(void){return _capacity;}
+
+    // This marks every value as not yet updated, at the start of an update
+    void clear(void);
+    // This stores a value
+    void setValue(uint8_t varNum, float value, uint8_t flags, uint32_t timestamp);
+
+    float getValue(uint8_t varNum){return _values[varNum];}
+    uint8_t getFlags(uint8_t varNum){return _flags[varNum];}
+    uint32_t getTimestamp(uint8_t varNum){return _timestamps[varNum];}
+
+    // These give the whole arrays, to be read in order or copied
+    const float *getValues(void){return _values;}
+    const uint8_t *getFlagArray(void){return _flags;}
+    const uint32_t *getTimestamps(void){return _timestamps;}
+
+protected:
+    float *_values;
+    uint8_t *_flags;
+    uint32_t *_timestamps;
+    uint8_t _capacity;
+};
+
+
+// A store with space for up to MAX_VARIABLES values
+// NOTE:  This takes 9 x MAX_VARIABLES bytes of RAM.
+template <uint8_t MAX_VARIABLES>
+class VariableValueBuffer : public VariableValueStore
+{
+public:
+    VariableValueBuffer()
+      : VariableValueStore(_valueBuffer, _flagBuffer, _timestampBuffer, MAX_VARIABLES) {}
+
+private:
+    float _valueBuffer[MAX_VARIABLES];
+    uint8_t _flagBuffer[MAX_VARIABLES];
+    uint32_t _timestampBuffer[MAX_VARIABLES];
+};
+
+#endif  // Header Guard
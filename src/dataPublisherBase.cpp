@@ -23,6 +23,10 @@ dataPublisher::dataPublisher()
     _inClient = NULL;
     _sendEveryX = 1;
     _sendOffset = 0;
+    _sendTimeCount = 0;
+    _backlogRecords = 0;
+    _backlogBytes = 0;
+    _nextRecord = 0;
     // MS_DBG(F("dataPublisher object created"));
 }
 dataPublisher::dataPublisher(Logger& baseLogger, uint8_t sendEveryX, uint8_t sendOffset)
@@ -32,6 +36,10 @@ dataPublisher::dataPublisher(Logger& baseLogger, uint8_t sendEveryX, uint8_t sen
     _sendEveryX = sendEveryX;
     _sendOffset = sendOffset;
     _inClient = NULL;
+    _sendTimeCount = 0;
+    _backlogRecords = 0;
+    _backlogBytes = 0;
+    _nextRecord = 0;
     // MS_DBG(F("dataPublisher object created"));
 }
 dataPublisher::dataPublisher(Logger& baseLogger, Client *inClient, uint8_t sendEveryX, uint8_t sendOffset)
@@ -41,6 +49,10 @@ dataPublisher::dataPublisher(Logger& baseLogger, Client *inClient, uint8_t sendE
     _sendEveryX = sendEveryX;
     _sendOffset = sendOffset;
     _inClient = inClient;
+    _sendTimeCount = 0;
+    _backlogRecords = 0;
+    _backlogBytes = 0;
+    _nextRecord = 0;
     // MS_DBG(F("dataPublisher object created"));
 }
 // Destructor
@@ -60,7 +72,6 @@ void dataPublisher::attachToLogger(Logger& baseLogger)
 
 
 // Sets the parameters for frequency of sending and any offset, if needed
-// NOTE:  These parameters are not currently used!!
 void dataPublisher::setSendFrequency(uint8_t sendEveryX, uint8_t sendOffset)
 {
     _sendEveryX = sendEveryX;
@@ -68,6 +79,88 @@ void dataPublisher::setSendFrequency(uint8_t sendEveryX, uint8_t sendOffset)
 }
 
 
+// Adds a time of day to send at
+bool dataPublisher::addSendTime(uint8_t hour, uint8_t minute)
+{
+    if (_sendTimeCount >= MS_MAX_SEND_TIMES) return false;
+    _sendTimes[_sendTimeCount++] = (uint16_t)hour*60 + minute;
+    return true;
+}
+
+
+// Sets the backlog to send at
+void dataPublisher::setBacklogThreshold(uint8_t records, uint16_t bytes)
+{
+    _backlogRecords = records;
+    _backlogBytes = bytes;
+}
+
+
+// This checks if the publisher is due to send at the logger's marked time
+bool dataPublisher::checkSendDue(uint8_t pendingRecords)
+{
+    if (_baseLogger == NULL) return false;
+    uint32_t markedTime = Logger::markedEpochTime;
+    uint32_t intervalSeconds = _baseLogger->getLoggingIntervalSeconds();
+
+    // Records taken between intervals, ie during a burst, are only sent on
+    // schedule with the next regular record
+    bool onInterval = markedTime % intervalSeconds == 0;
+
+    // Every X intervals
+    if (onInterval && _sendEveryX > 0 &&
+        (markedTime / intervalSeconds) % _sendEveryX == _sendOffset % _sendEveryX)
+    {
+        MS_DBG(getEndpoint(), F("is due on its interval"));
+        return true;
+    }
+
+    // At a time of day that has passed since the last interval
+    uint32_t secondOfDay = markedTime % 86400L;
+    for (uint8_t i = 0; i < _sendTimeCount && onInterval; i++)
+    {
+        uint32_t sinceSendTime = (secondOfDay + 86400L - (uint32_t)_sendTimes[i]*60) % 86400L;
+        if (sinceSendTime < intervalSeconds)
+        {
+            MS_DBG(getEndpoint(), F("is due at"), _sendTimes[i], F("minutes after midnight"));
+            return true;
+        }
+    }
+
+    // With too many records waiting
+    LoggerRecordBuffer *buffer = _baseLogger->getRecordBuffer();
+    if (buffer != NULL && (_backlogRecords > 0 || _backlogBytes > 0))
+    {
+        uint16_t unsent = buffer->getRecordCountFrom(_nextRecord) + pendingRecords;
+        // Each record is a timestamp and a float for each variable
+        uint32_t unsentBytes = (uint32_t)unsent*(4 + 4*_baseLogger->getArrayVarCount());
+        if ((_backlogRecords > 0 && unsent >= _backlogRecords) ||
+            (_backlogBytes > 0 && unsentBytes >= _backlogBytes))
+        {
+            MS_DBG(getEndpoint(), F("is due with"), unsent, F("records waiting"));
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+// This checks if a return from publishData() means the data was accepted
+// By default, any HTTP success code
+bool dataPublisher::publishSucceeded(int16_t responseCode)
+{
+    return responseCode >= 200 && responseCode < 300;
+}
+
+
+// This checks if a failed return from publishData() is worth trying again
+bool dataPublisher::publishRetryable(int16_t responseCode)
+{
+    return responseCode <= 0 || responseCode >= 500;
+}
+
+
 // "Begins" the publisher - attaches client and logger
 void dataPublisher::begin(Logger& baseLogger, Client *inClient)
 {
@@ -26,6 +26,9 @@
 // Maximum Transmission Unit).
 #define MS_SEND_BUFFER_SIZE 750
 
+// The largest number of times of day a publisher can be set to send at
+#define MS_MAX_SEND_TIMES 4
+
 // Included Dependencies
 #include "ModSensorDebugger.h"
 #undef MS_DEBUGGING_STD
@@ -53,8 +56,38 @@ public:
     void attachToLogger(Logger& baseLogger);
 
     // Sets the parameters for frequency of sending and any offset, if needed
-    // NOTE:  These parameters are not currently used!!
+    // The publisher is due every sendEveryX logging intervals (counted from
+    // the start of the epoch, 1970-01-01 00:00 in the logger's time zone),
+    // sendOffset intervals later.  Set sendEveryX to 0 to only send at the
+    // times of day or backlog set below.
     void setSendFrequency(uint8_t sendEveryX, uint8_t sendOffset);
+    // Adds a time of day, in the logger's time zone, for the publisher to be
+    // due at.  Returns false if there's no room for another time.
+    bool addSendTime(uint8_t hour, uint8_t minute);
+    // Makes the publisher due whenever at least this many records, or this
+    // many bytes of record data, are waiting to be sent in the logger's record
+    // buffer.  0 to ignore.
+    void setBacklogThreshold(uint8_t records, uint16_t bytes = 0);
+
+    // This checks if the publisher is due to send at the logger's marked time
+    // pendingRecords are records about to be added to the logger's buffer.
+    virtual bool checkSendDue(uint8_t pendingRecords = 0);
+    // This checks if a return from publishData() means the data was accepted
+    virtual bool publishSucceeded(int16_t responseCode);
+    // This checks if a failed return from publishData() is worth sending the
+    // same data again for.  By default, only failures to connect (0 or less)
+    // and server errors (5xx) are; anything else (ie, a 4xx) means the data
+    // itself was refused and will never be accepted.
+    virtual bool publishRetryable(int16_t responseCode);
+    // The most records from the logger's record buffer the receiver can take
+    // in one session.  If more are waiting, only the newest are sent and the
+    // rest are skipped.  0, the default, for no limit.
+    virtual uint8_t getMaxRecordsPerSession(void){return 0;}
+
+    // The sequence number of the next record in the logger's record buffer
+    // for this publisher to send
+    uint32_t getNextRecord(void){return _nextRecord;}
+    void setNextRecord(uint32_t sequence){_nextRecord = sequence;}
 
     // "Begins" the publisher - attaches client and logger
     // Not doing this in the constructor because we expect the publishers to be
@@ -95,6 +128,12 @@ protected:
 
     uint8_t _sendEveryX;
     uint8_t _sendOffset;
+    // The times of day to send at, in minutes from midnight
+    uint16_t _sendTimes[MS_MAX_SEND_TIMES];
+    uint8_t _sendTimeCount;
+    uint8_t _backlogRecords;
+    uint16_t _backlogBytes;
+    uint32_t _nextRecord;
 
     // Basic chunks of HTTP
     static const char *getHeader;
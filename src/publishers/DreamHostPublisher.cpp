@@ -73,7 +73,7 @@ void DreamHostPublisher::printSensorDataDreamHost(Stream *stream)
     stream->print(loggerTag);
     stream->print(_baseLogger->getLoggerID());
     stream->print(timestampTagDH);
-    stream->print(String(Logger::markedEpochTime - 946684800));  // Correct time from epoch to y2k
+    stream->print(String(_baseLogger->getRecordEpochTime() - 946684800));  // Correct time from epoch to y2k
 
     for (uint8_t i = 0; i < _baseLogger->getArrayVarCount(); i++)
     {
@@ -146,7 +146,7 @@ int16_t DreamHostPublisher::publishData(Client *_outClient)
 
         if (bufferFree() < 22) printTxBuffer(_outClient);
         strcat(txBuffer, timestampTagDH);
-        ltoa((Logger::markedEpochTime - 946684800), tempBuffer, 10);  // BASE 10
+        ltoa((_baseLogger->getRecordEpochTime() - 946684800), tempBuffer, 10);  // BASE 10
         strcat(txBuffer, tempBuffer);
 
         for (uint8_t i = 0; i < _baseLogger->getArrayVarCount(); i++)
@@ -129,7 +129,7 @@ void EnviroDIYPublisher::printSensorDataJSON(Stream *stream)
     stream->print(samplingFeatureTag);
     stream->print(_baseLogger->getSamplingFeatureUUID());
     stream->print(timestampTag);
-    stream->print(_baseLogger->formatDateTime_ISO8601(Logger::markedEpochTime));
+    stream->print(Logger::getISO8601Time(_baseLogger->getRecordEpochTime()));
     stream->print(F("\","));
 
     for (uint8_t i = 0; i < _baseLogger->getArrayVarCount(); i++)
@@ -249,8 +249,7 @@ int16_t EnviroDIYPublisher::publishData(Client *_outClient)
 
         if (bufferFree() < 42) printTxBuffer(_outClient);
         strcat(txBuffer, timestampTag);
-        _baseLogger->formatDateTime_ISO8601(Logger::markedEpochTime).toCharArray(tempBuffer, 37);
-        strcat(txBuffer, tempBuffer);
+        strcat(txBuffer, Logger::getISO8601Time(_baseLogger->getRecordEpochTime()));
         txBuffer[strlen(txBuffer)] = '"';
         txBuffer[strlen(txBuffer)] = ',';
 
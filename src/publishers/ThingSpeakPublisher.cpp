@@ -150,9 +150,8 @@ int16_t ThingSpeakPublisher::publishData(Client *_outClient)
 
     emptyTxBuffer();
 
-    _baseLogger->formatDateTime_ISO8601(Logger::markedEpochTime).toCharArray(tempBuffer, 26);
     strcat(txBuffer, "created_at=");
-    strcat(txBuffer, tempBuffer);
+    strcat(txBuffer, Logger::getISO8601Time(_baseLogger->getRecordEpochTime()));
     txBuffer[strlen(txBuffer)] = '&';
 
     for (uint8_t i = 0; i < numChannels; i++)
@@ -216,3 +215,10 @@ int16_t ThingSpeakPublisher::publishData(Client *_outClient)
     MS_DBG(F("Disconnected after"), MS_PRINT_DEBUG_TIMER, F("ms"));
     return retVal;
 }
+
+
+// The MQTT publish returns true for success rather than an HTTP code
+bool ThingSpeakPublisher::publishSucceeded(int16_t responseCode)
+{
+    return responseCode == true;
+}
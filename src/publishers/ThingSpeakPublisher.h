@@ -87,6 +87,11 @@ public:
     // This sends the data to ThingSpeak
     // bool mqttThingSpeak(void);
     virtual int16_t publishData(Client *_outClient);
+    // The MQTT publish returns true for success rather than an HTTP code
+    virtual bool publishSucceeded(int16_t responseCode);
+    // ThingSpeak only takes one update to a channel every 15 seconds and
+    // drops the rest without any error, so only the newest record is sent
+    virtual uint8_t getMaxRecordsPerSession(void){return 1;}
 
 protected:
     static const char *mqttServer;
@@ -14,6 +14,34 @@
 */
 
 #include "AdafruitTSL2591.h"
+#include <Wire.h>
+
+// The gain/integration combinations used when auto-ranging, in order of
+// increasing sensitivity (gain multiplier x integration time).  The short
+// integration times are preferred so the measurement finishes quickly.
+struct tsl2591Range_t
+{
+    tsl2591Gain_t gain;
+    tsl2591IntegrationTime_t integration;
+    float sensitivity;
+};
+static const tsl2591Range_t tsl2591Ranges[] = {
+    {TSL2591_GAIN_LOW,  TSL2591_INTEGRATIONTIME_100MS,     100},
+    {TSL2591_GAIN_MED,  TSL2591_INTEGRATIONTIME_100MS,    2500},
+    {TSL2591_GAIN_HIGH, TSL2591_INTEGRATIONTIME_100MS,   42800},
+    {TSL2591_GAIN_HIGH, TSL2591_INTEGRATIONTIME_300MS,  128400},
+    {TSL2591_GAIN_MAX,  TSL2591_INTEGRATIONTIME_100MS,  987600},
+    {TSL2591_GAIN_MAX,  TSL2591_INTEGRATIONTIME_300MS, 2962800},
+    {TSL2591_GAIN_MAX,  TSL2591_INTEGRATIONTIME_600MS, 5925600},
+};
+#define TSL2591_NUM_RANGES (sizeof(tsl2591Ranges)/sizeof(tsl2591Ranges[0]))
+
+// The ADC saturates at a lower count for the 100ms integration time
+static uint16_t tsl2591MaxCounts(tsl2591IntegrationTime_t integration)
+{
+    if (integration == TSL2591_INTEGRATIONTIME_100MS) return TSL2591_MAX_COUNT_100MS;
+    return TSL2591_MAX_COUNT;
+}
 
 
 // The constructor - because this is I2C, only need the power pin
@@ -26,6 +54,14 @@ AdafruitTSL2591::AdafruitTSL2591(int8_t powerPin, uint8_t i2cAddressHex, uint8_t
     _i2cAddressHex  = i2cAddressHex;
     _gain = gain;
     _integration = integration;
+    _autoRange = false;
+    _rangeLevel = 0;
+    _rangeRetries = 0;
+    _fullCounts = 0;
+    _irCounts = 0;
+    _haveCounts = false;
+    // Each integration step is 100ms; allow for the ADC running up to 10% slow
+    _measurementTime_ms = ((uint32_t)_integration + 1)*110;
 }
 // Destructor
 AdafruitTSL2591::~AdafruitTSL2591(){};
@@ -41,8 +77,6 @@ String AdafruitTSL2591::getSensorLocation(void)
 
 bool AdafruitTSL2591::setup(void)
 {
-    // GNOTE: ADD OVERSAMPLING SETUP
-
     bool retVal = Sensor::setup();  // this will set pin modes and the setup status bit
 
     // This sensor needs power for setup!
@@ -69,13 +103,12 @@ bool AdafruitTSL2591::setup(void)
     }
     retVal &= success;
 
-    // Turn the power back off it it had been turned on
-    if (!wasOn) {powerDown();}
-
     //set gain and timing
     tsl_internal.setGain(_gain);
     tsl_internal.setTiming(_integration);
 
+    // Turn the power back off it it had been turned on
+    if (!wasOn) {powerDown();}
 
     return retVal;
 }
@@ -88,34 +121,158 @@ bool AdafruitTSL2591::wake(void)
     // there's no reason to go on.
     if (!Sensor::wake()) return false;
 
-    // Restart always needed after power-up to set sampling modes
-    // As of Adafruit library version 1.0.7, this function includes all of the
-    // various delays to allow the chip to wake up, get calibrations, get
-    // coefficients, and set sampling modes.
-    // This will also restart "Wire"
-    // Currently this is using the settings that Adafruit considered to be 'default'
+    // The gain and integration time are written with each conversion, so
+    // there's nothing else to wait for here.
+    return true;
+}
+
+
+void AdafruitTSL2591::setAutoRange(bool autoRange)
+{
+    _autoRange = autoRange;
+    // Start from the middle of the ladder until there's a reading to go by
+    if (_autoRange) setRangeLevel(TSL2591_NUM_RANGES/2);
+}
 
-    delay(100);//G NOTE: TEST IF NEEDED
+
+void AdafruitTSL2591::setRangeLevel(uint8_t level)
+{
+    _rangeLevel = min(level, (uint8_t)(TSL2591_NUM_RANGES - 1));
+    _gain = tsl2591Ranges[_rangeLevel].gain;
+    _integration = tsl2591Ranges[_rangeLevel].integration;
+    _measurementTime_ms = ((uint32_t)_integration + 1)*110;
+}
+
+
+// This picks the most sensitive range that a reading (taken at the current
+// range) would not fill more than half way, so there's room for it to brighten.
+uint8_t AdafruitTSL2591::chooseRangeLevel(uint16_t fullCounts)
+{
+    float currentSensitivity = tsl2591Ranges[_rangeLevel].sensitivity;
+    uint8_t level = 0;
+    for (uint8_t i = 0; i < TSL2591_NUM_RANGES; i++)
+    {
+        float predicted = (float)fullCounts*tsl2591Ranges[i].sensitivity/currentSensitivity;
+        if (predicted < tsl2591MaxCounts(tsl2591Ranges[i].integration)/2) level = i;
+    }
+    return level;
+}
+
+
+bool AdafruitTSL2591::startSingleMeasurement(void)
+{
+    // Sensor::startSingleMeasurement() checks that if it's awake/active and sets
+    // the timestamp and status bits.  If it returns false, there's no reason to go on.
+    if (!Sensor::startSingleMeasurement()) return false;
+
+    _rangeRetries = 0;
+    if (!startConversion())
+    {
+        MS_DBG(getSensorNameAndLocation(), F("did not successfully start a measurement."));
+        _millisMeasurementRequested = 0;
+        _sensorStatus &= 0b10111111;
+        return false;
+    }
     return true;
 }
 
 
+// This sets the gain and integration time and powers on the ADC
+bool AdafruitTSL2591::startConversion(void)
+{
+    _haveCounts = false;
+    // These also keep the library's copy of the gain and integration time in
+    // sync for calculating lux.
+    tsl_internal.setGain(_gain);
+    tsl_internal.setTiming(_integration);
+
+    Wire.beginTransmission(_i2cAddressHex);
+    Wire.write(TSL2591_COMMAND_BIT | TSL2591_REGISTER_ENABLE);
+    Wire.write(TSL2591_ENABLE_POWERON | TSL2591_ENABLE_AEN);
+    if (Wire.endTransmission() != 0) return false;
+    _millisMeasurementRequested = millis();
+    MS_DBG(F("  Gain:"), String(_gain, HEX), F("Integration:"), _integration);
+    return true;
+}
+
+
+bool AdafruitTSL2591::readChannels(void)
+{
+    Wire.beginTransmission(_i2cAddressHex);
+    Wire.write(TSL2591_COMMAND_BIT | TSL2591_REGISTER_CHAN0_LOW);
+    if (Wire.endTransmission() != 0) return false;
+    if (Wire.requestFrom(_i2cAddressHex, (uint8_t)4) != 4) return false;
+    _fullCounts = Wire.read();
+    _fullCounts |= (uint16_t)Wire.read() << 8;
+    _irCounts = Wire.read();
+    _irCounts |= (uint16_t)Wire.read() << 8;
+    return true;
+}
+
+
+bool AdafruitTSL2591::isMeasurementComplete(bool debug)
+{
+    // If a measurement failed to start, the sensor will never return a result
+    if (!bitRead(_sensorStatus, 6)) return true;
+    if (_haveCounts) return true;
+
+    // Wait out the integration time in use
+    if (!Sensor::isMeasurementComplete(debug)) return false;
+
+    if (!readChannels())
+    {
+        _fullCounts = 0;
+        _irCounts = 0;
+    }
+    _haveCounts = true;
+    if (!_autoRange || _rangeRetries >= TSL2591_MAX_AUTORANGE_RETRIES) return true;
+
+    // Only convert again if the reading is saturated or too low to use
+    uint8_t newLevel = _rangeLevel;
+    uint16_t maxCounts = tsl2591MaxCounts(_integration);
+    if (_fullCounts >= maxCounts - maxCounts/16 && _rangeLevel > 0)
+    {
+        // The true brightness is unknown, so step well down
+        newLevel = _rangeLevel > 2 ? _rangeLevel - 2 : 0;
+    }
+    else if (_fullCounts < TSL2591_UNDERFLOW_COUNTS && _rangeLevel < TSL2591_NUM_RANGES - 1)
+    {
+        newLevel = _fullCounts > 0 ? chooseRangeLevel(_fullCounts) : TSL2591_NUM_RANGES - 1;
+        if (newLevel <= _rangeLevel) newLevel = _rangeLevel + 1;
+    }
+    if (newLevel == _rangeLevel) return true;
+
+    MS_DBG(F("  Full spectrum count of"), _fullCounts, F("out of range, changing range from"),
+           _rangeLevel, F("to"), newLevel);
+    setRangeLevel(newLevel);
+    _rangeRetries++;
+    if (!startConversion()) return true;
+    return false;
+}
+
+
 bool AdafruitTSL2591::addSingleMeasurementResult(void)
 {
     bool success = false;
 
     // declare measurement variables
-    uint32_t lum;
-    float full, ir, vis, lux;
+    float full = -9999;
+    float ir = -9999;
+    float vis = -9999;
+    float lux = -9999;
 
     // Check a measurement was *successfully* started (status bit 6 set)
     // Only go on to get a result if it was
     if (bitRead(_sensorStatus, 6))
     {
         MS_DBG(getSensorNameAndLocation(), F("is reporting:"));
-        lum = tsl_internal.getFullLuminosity();
-        ir = (float)(lum >> 16);
-        full = (float)(lum & 0xFFFF);
+        // Finish the conversion if we somehow got here early
+        while (!isMeasurementComplete()) {}
+        // Power the ADC back down until the next measurement
+        tsl_internal.disable();
+
+        ir = (float)_irCounts;
+        full = (float)_fullCounts;
         vis = full - ir;
 
         if (isnan(ir) || (ir == 0)) ir = -9999;
@@ -123,10 +280,19 @@ bool AdafruitTSL2591::addSingleMeasurementResult(void)
         if (isnan(vis) || (vis == 0)) vis = -9999;
 
 
+        // The library's calculation uses the gain and integration time set
+        // for this conversion; it returns -1 on overflow.
         if ((ir!=-9999) && (full!=-9999)) {
-          lux = tsl_internal.calculateLux(ir, full);
+          lux = tsl_internal.calculateLux(_fullCounts, _irCounts);
+          if (lux < 0) lux = -9999;
         } else lux = -9999;
 
+        // Pick the range for the next measurement from this one
+        if (_autoRange && _fullCounts > 0)
+        {
+            setRangeLevel(chooseRangeLevel(_fullCounts));
+        }
+
 
         // Assume that if all three are 0, really a failed response
         // May also return a very negative temp when receiving a bad response
@@ -157,6 +323,7 @@ bool AdafruitTSL2591::addSingleMeasurementResult(void)
     _millisMeasurementRequested = 0;
     // Unset the status bits for a measurement request (bits 5 & 6)
     _sensorStatus &= 0b10011111;
+    _haveCounts = false;
 
     return success;
 }
@@ -37,6 +37,10 @@
  *                TSL2591_INTEGRATIONTIME_500MS     = 0x04,   500 millis
  *                TSL2591_INTEGRATIONTIME_600MS     = 0x05,   600 millis
  *
+ *    3. Auto-ranging:  Instead of a fixed gain and integration time, call
+ *      setAutoRange(true) to have them chosen from the previous reading.  A
+ *      conversion is only repeated if it saturates or reads too low to use.
+ *
  * Power Consumption:
  *  0.4 mA when active
  *  3 uA sleep
@@ -91,6 +95,12 @@
 #define TSL2591_WARM_UP_TIME_MS 100                                             //TODO: TEST
 #define TSL2591_STABILIZATION_TIME_MS 100                                       // TODO experiment with this value
 #define TSL2591_MEASUREMENT_TIME_MS 600
+// NOTE:  The measurement time is recalculated from the integration time in use
+
+// The lowest count considered usable when auto-ranging
+#define TSL2591_UNDERFLOW_COUNTS 100
+// The number of times a conversion may be repeated at a new gain/integration
+#define TSL2591_MAX_AUTORANGE_RETRIES 3
 
 
 #define TSL2591_ILLUMINANCE_RESOLUTION 1                                        //TODO: WHAT TO DO ABOUT RESONLUTIONS FOR THESE VARS?
@@ -120,15 +130,37 @@ public:
     bool setup(void) override;
     String getSensorLocation(void) override;
 
-    // bool startSingleMeasurement(void) override;  // for forced mode
+    bool startSingleMeasurement(void) override;
     bool addSingleMeasurementResult(void) override;
 
+    // This reads the channels once the integration time has passed and, when
+    // auto-ranging, restarts the conversion if the counts are out of range.
+    bool isMeasurementComplete(bool debug=false) override;
+
+    // Turns on or off choosing the gain and integration time automatically
+    void setAutoRange(bool autoRange);
+
 protected:
     Adafruit_TSL2591 tsl_internal;
     uint8_t _i2cAddressHex;
     // user programmable parameters:
     tsl2591Gain_t _gain;
     tsl2591IntegrationTime_t _integration;
+
+private:
+    bool _autoRange;
+    // The step of the auto-range ladder in use
+    uint8_t _rangeLevel;
+    uint8_t _rangeRetries;
+    // The raw counts of the finished conversion
+    uint16_t _fullCounts;
+    uint16_t _irCounts;
+    bool _haveCounts;
+
+    bool startConversion(void);
+    bool readChannels(void);
+    void setRangeLevel(uint8_t level);
+    uint8_t chooseRangeLevel(uint16_t fullCounts);
 };
 
 
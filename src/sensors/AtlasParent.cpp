@@ -14,6 +14,14 @@
 
 #include "AtlasParent.h"
 #include <Wire.h>
+#if (defined(ARDUINO_ARCH_AVR) || defined(__AVR__)) && ATLAS_CONFIG_CACHE_SLOTS > 0
+#define ATLAS_USE_CONFIG_CACHE
+#include <EEPROM.h>
+#endif
+
+
+// The records of the circuits' settings are off until asked for
+int16_t AtlasParent::_configCacheStart = -1;
 
 
 // The constructor - because this is I2C, only need the power pin
@@ -25,7 +33,12 @@ AtlasParent::AtlasParent(int8_t powerPin, uint8_t i2cAddressHex, uint8_t measure
            warmUpTime_ms, stabilizationTime_ms, measurementTime_ms,
            powerPin, -1, measurementsToAverage),
     _i2cAddressHex(i2cAddressHex)
-{}
+{
+    _responseCode = 0;
+    _millisLastPoll = 0;
+    for (uint8_t i = 0; i < ATLAS_MAX_NUM_VARIABLES; i++)
+        _responseValues[i] = -9999;
+}
 AtlasParent::~AtlasParent(){}
 
 
@@ -111,6 +124,9 @@ bool AtlasParent::startSingleMeasurement(void)
     {
         // Update the time that a measurement was requested
         _millisMeasurementRequested = millis();
+        _millisLastPoll = _millisMeasurementRequested;
+        // Clear out the response from any previous measurement
+        _responseCode = 0;
     }
     // Otherwise, make sure that the measurement start time and success bit (bit 6) are unset
     else
@@ -132,14 +148,12 @@ bool AtlasParent::addSingleMeasurementResult(void)
     // Only go on to get a result if it was
     if (bitRead(_sensorStatus, 6))
     {
-        // call the circuit and request 40 bytes (this may be more than we need)
-        Wire.requestFrom(_i2cAddressHex, 40, 1);
-        // the first byte is the response code, we read this separately.
-        uint8_t code=Wire.read();
+        // If the result wasn't already picked up while polling, read it now
+        if (_responseCode == 0 || _responseCode == 254) _responseCode = readResponse();
 
         MS_DBG(getSensorNameAndLocation(), F("is reporting:"));
         // Parse the response code
-        switch (code)
+        switch (_responseCode)
         {
             case 1:  // the command was successful.
                 MS_DBG(F("  Measurement successful"));
@@ -158,16 +172,13 @@ bool AtlasParent::addSingleMeasurementResult(void)
                 MS_DBG(F("  No Data"));
             break;
         }
-        // If the response code is successful, parse the remaining results
+        // If the response code is successful, add the parsed results
         if (success)
         {
             for (uint8_t i = 0; i < _numReturnedVars; i++)
             {
-                float result = Wire.parseFloat();
-                if (isnan(result)) result = -9999;
-                if (result < -1020) result = -9999;
-                MS_DBG(F("  Result #"), i, ':', result);
-                verifyAndAddMeasurementResult(i, result);
+                MS_DBG(F("  Result #"), i, ':', _responseValues[i]);
+                verifyAndAddMeasurementResult(i, _responseValues[i]);
             }
         }
     }
@@ -186,11 +197,89 @@ bool AtlasParent::addSingleMeasurementResult(void)
     _millisMeasurementRequested = 0;
     // Unset the status bits for a measurement request (bits 5 & 6)
     _sensorStatus &= 0b10011111;
+    // Clear the response so it can't be used twice
+    _responseCode = 0;
 
     return success;
 }
 
 
+// This polls the circuit for a finished measurement
+bool AtlasParent::isMeasurementComplete(bool debug)
+{
+    // If the measurement time has passed or a measurement was never started,
+    // there's no reason to poll
+    if (Sensor::isMeasurementComplete(debug)) return true;
+
+    // If we've already gotten a final response, we're done
+    if (_responseCode != 0 && _responseCode != 254) return true;
+
+    // Don't poll more often than the polling interval
+    if (millis() - _millisLastPoll < ATLAS_POLL_INTERVAL_MS) return false;
+    _millisLastPoll = millis();
+
+    // Reading the response while the circuit is still working only returns
+    // the "pending" code of 254; once finished, this reads the whole result.
+    _responseCode = readResponse();
+    if (_responseCode == 0 || _responseCode == 254) return false;
+
+    if (debug) {MS_DBG(F("Measurement by"), getSensorNameAndLocation(),
+                      F("finished after"), millis() - _millisMeasurementRequested,
+                      F("ms with code"), _responseCode);}
+    return true;
+}
+
+
+// This reads a response from the circuit into the response values
+// The response is a one byte code followed by the values as comma separated
+// ASCII characters and finally a null character.
+uint8_t AtlasParent::readResponse(void)
+{
+    for (uint8_t i = 0; i < ATLAS_MAX_NUM_VARIABLES; i++)
+        _responseValues[i] = -9999;
+
+    // Only request as many bytes as the values could possibly need
+    uint8_t nBytes = 1 + _numReturnedVars*ATLAS_MAX_CHARS_PER_VALUE;
+    if (nBytes > ATLAS_MAX_RESPONSE_BYTES) nBytes = ATLAS_MAX_RESPONSE_BYTES;
+    Wire.requestFrom((uint8_t)_i2cAddressHex, nBytes, (uint8_t)1);
+    if (!Wire.available()) return 0;
+    // the first byte is the response code, we read this separately.
+    uint8_t code = Wire.read();
+
+    if (code == 1)
+    {
+        char valueBuffer[ATLAS_MAX_CHARS_PER_VALUE + 1];
+        uint8_t nChars = 0;
+        uint8_t valueNum = 0;
+        bool endOfResponse = false;
+        while (!endOfResponse && valueNum < _numReturnedVars &&
+               valueNum < ATLAS_MAX_NUM_VARIABLES)
+        {
+            // Running out of bytes also ends the last value
+            int c = Wire.available() ? Wire.read() : 0;
+            if (c == ',' || c == 0)
+            {
+                valueBuffer[nChars] = 0;
+                char *endPtr;
+                float result = strtod(valueBuffer, &endPtr);
+                if (endPtr == valueBuffer) result = -9999;  // nothing to parse
+                if (isnan(result)) result = -9999;
+                if (result < -1020) result = -9999;
+                _responseValues[valueNum++] = result;
+                nChars = 0;
+                endOfResponse = (c == 0);
+            }
+            else if (nChars < ATLAS_MAX_CHARS_PER_VALUE) valueBuffer[nChars++] = c;
+        }
+    }
+
+    // Empty anything left in the buffer
+    while (Wire.available()) Wire.read();
+
+    return code;
+}
+
+
 // Wait for a command to process
 // NOTE:  This should ONLY be used as a wait when no response is
 // expected except a status code - the response will be "consumed"
@@ -198,13 +287,237 @@ bool AtlasParent::addSingleMeasurementResult(void)
 bool AtlasParent::waitForProcessing(uint32_t timeout)
 {
     // Wait for the command to have been processed and implented
+    // Poll no more often than the polling interval so we're not flooding the
+    // bus while the circuit is working
     bool processed = false;
     uint32_t start = millis();
+    uint32_t lastPoll = start;
     while (!processed && millis() - start < timeout)
     {
-        Wire.requestFrom(_i2cAddressHex, 1, 1);
-        uint8_t code=Wire.read();
-        if (code == 1) processed = true;
+        if (millis() - lastPoll >= ATLAS_POLL_INTERVAL_MS)
+        {
+            lastPoll = millis();
+            Wire.requestFrom((uint8_t)_i2cAddressHex, (uint8_t)1, (uint8_t)1);
+            uint8_t code=Wire.read();
+            if (code == 1) processed = true;
+        }
     }
     return processed;
 }
+
+
+// Sends a single command to the circuit
+bool AtlasParent::sendCommand(const char *command)
+{
+    Wire.beginTransmission(_i2cAddressHex);
+    bool success = Wire.write((const uint8_t *)command, strlen(command));
+    success &= !Wire.endTransmission();
+    // NOTE: The return of 0 from endTransmission indicates success
+    return success;
+}
+
+
+// Wait for a command to process and read the text of the response
+bool AtlasParent::waitForResponse(char *responseBuffer, uint8_t bufferSize,
+                                  uint32_t timeout)
+{
+    bool processed = false;
+    uint32_t start = millis();
+    uint32_t lastPoll = start;
+    responseBuffer[0] = 0;
+    while (!processed && millis() - start < timeout)
+    {
+        if (millis() - lastPoll >= ATLAS_POLL_INTERVAL_MS)
+        {
+            lastPoll = millis();
+            Wire.requestFrom((uint8_t)_i2cAddressHex,
+                             (uint8_t)ATLAS_MAX_RESPONSE_BYTES, (uint8_t)1);
+            uint8_t code = Wire.read();
+            if (code == 1)
+            {
+                processed = true;
+                uint8_t nChars = 0;
+                while (Wire.available() && nChars < bufferSize - 1)
+                {
+                    char c = Wire.read();
+                    if (c == 0) break;
+                    responseBuffer[nChars++] = c;
+                }
+                responseBuffer[nChars] = 0;
+            }
+            else if (code != 254) break;  // failed or no data
+            // Empty anything left in the buffer
+            while (Wire.available()) Wire.read();
+        }
+    }
+    return processed;
+}
+
+
+// This makes sure that all of the given output parameters are enabled
+bool AtlasParent::enableOutputParameters(const char *const parameters[],
+                                         uint8_t nParameters)
+{
+    uint16_t configHash = hashOutputParameters(parameters, nParameters);
+    if (checkConfigCache(configHash))
+    {
+        MS_DBG(getSensorNameAndLocation(),
+               F("is already known to have the right output parameters"));
+        return true;
+    }
+
+    // The sensor needs power to check and change settings
+    bool wasOn = checkPowerOn();
+    if (!wasOn) {powerUp();}
+    waitForWarmUp();
+
+    // Ask the circuit which parameters it's currently putting out
+    // The response will be something like "?O,EC,TDS,S,SG"
+    char current[ATLAS_MAX_RESPONSE_BYTES];
+    bool gotCurrent = sendCommand("O,?");
+    gotCurrent &= waitForResponse(current, sizeof(current));
+    if (gotCurrent) {MS_DBG(getSensorNameAndLocation(), F("is reporting"), current);}
+    else {MS_DBG(F("Unable to get the current output parameters from"),
+                 getSensorNameAndLocation());}
+
+    bool success = true;
+    for (uint8_t i = 0; i < nParameters; i++)
+    {
+        // Look for the parameter in the comma separated list, skipping the
+        // leading "?O"
+        bool isEnabled = false;
+        if (gotCurrent)
+        {
+            const char *token = strchr(current, ',');
+            uint8_t paramLength = strlen(parameters[i]);
+            while (token != NULL && !isEnabled)
+            {
+                token++;
+                const char *tokenEnd = strchr(token, ',');
+                uint8_t tokenLength = tokenEnd == NULL ? strlen(token) : tokenEnd - token;
+                isEnabled = (tokenLength == paramLength &&
+                             strncasecmp(token, parameters[i], paramLength) == 0);
+                token = tokenEnd;
+            }
+        }
+
+        if (isEnabled)
+        {
+            MS_DBG(getSensorNameAndLocation(), F("already reports"), parameters[i]);
+            continue;
+        }
+
+        MS_DBG(F("Asking"), getSensorNameAndLocation(), F("to report"), parameters[i]);
+        char command[ATLAS_MAX_CHARS_PER_VALUE + 5];
+        snprintf(command, sizeof(command), "O,%s,1", parameters[i]);
+        success &= sendCommand(command);
+        success &= waitForProcessing();
+    }
+
+    if (success) updateConfigCache(configHash);
+
+    // Turn the power back off it it had been turned on
+    if (!wasOn) {powerDown();}
+
+    return success;
+}
+
+
+// Makes a simple hash of the circuit address and requested parameters so a
+// change in either can be recognized
+uint16_t AtlasParent::hashOutputParameters(const char *const parameters[],
+                                           uint8_t nParameters)
+{
+    uint16_t hash = _i2cAddressHex;
+    for (uint8_t i = 0; i < nParameters; i++)
+    {
+        for (const char *c = parameters[i]; *c != 0; c++)
+            hash = (hash << 5) + hash + *c;
+        hash = (hash << 5) + hash + ',';
+    }
+    // 0xFFFF is what an erased EEPROM reads as, so never use it as a hash
+    if (hash == 0xFFFF) hash = 0;
+    return hash;
+}
+
+
+#if defined ATLAS_USE_CONFIG_CACHE
+
+// Turns on the records of the circuits' settings in the EEPROM
+void AtlasParent::enableConfigCache(int16_t startAddress)
+{
+    if (startAddress < 0) startAddress = E2END + 1 - 3*ATLAS_CONFIG_CACHE_SLOTS;
+    _configCacheStart = startAddress;
+}
+void AtlasParent::disableConfigCache(void) {_configCacheStart = -1;}
+
+
+// Checks if a record of this circuit's settings is in the EEPROM
+bool AtlasParent::checkConfigCache(uint16_t configHash)
+{
+    if (_configCacheStart < 0) return false;
+    for (uint8_t i = 0; i < ATLAS_CONFIG_CACHE_SLOTS; i++)
+    {
+        int slot = _configCacheStart + 3*i;
+        if (EEPROM.read(slot) == (uint8_t)_i2cAddressHex)
+        {
+            uint16_t storedHash = EEPROM.read(slot + 1) | (EEPROM.read(slot + 2) << 8);
+            return storedHash == configHash;
+        }
+    }
+    return false;
+}
+
+
+// Records this circuit's settings in the EEPROM, in the slot already used for
+// this circuit's address or the first empty slot
+void AtlasParent::updateConfigCache(uint16_t configHash)
+{
+    if (_configCacheStart < 0) return;
+    int slot = -1;
+    for (uint8_t i = 0; i < ATLAS_CONFIG_CACHE_SLOTS && slot < 0; i++)
+    {
+        int candidate = _configCacheStart + 3*i;
+        uint8_t storedAddress = EEPROM.read(candidate);
+        if (storedAddress == (uint8_t)_i2cAddressHex || storedAddress == 0xFF)
+            slot = candidate;
+    }
+    if (slot < 0)
+    {
+        MS_DBG(F("No room to record the settings of"), getSensorNameAndLocation());
+        return;
+    }
+    // NOTE:  update only writes bytes that have changed
+    EEPROM.update(slot, (uint8_t)_i2cAddressHex);
+    EEPROM.update(slot + 1, configHash & 0xFF);
+    EEPROM.update(slot + 2, configHash >> 8);
+}
+
+
+// Erases the slot used for this circuit's address, if there is one
+void AtlasParent::clearConfigCache(void)
+{
+    if (_configCacheStart < 0) return;
+    for (uint8_t i = 0; i < ATLAS_CONFIG_CACHE_SLOTS; i++)
+    {
+        int slot = _configCacheStart + 3*i;
+        if (EEPROM.read(slot) == (uint8_t)_i2cAddressHex)
+        {
+            MS_DBG(F("Forgetting the recorded settings of"), getSensorNameAndLocation());
+            EEPROM.update(slot, 0xFF);
+            EEPROM.update(slot + 1, 0xFF);
+            EEPROM.update(slot + 2, 0xFF);
+        }
+    }
+}
+
+#else
+
+// There's no EEPROM to keep a record in, so the circuit will always be asked
+void AtlasParent::enableConfigCache(int16_t) {}
+void AtlasParent::disableConfigCache(void) {}
+bool AtlasParent::checkConfigCache(uint16_t) {return false;}
+void AtlasParent::updateConfigCache(uint16_t) {}
+void AtlasParent::clearConfigCache(void) {}
+
+#endif
@@ -10,6 +10,21 @@
  * commands to take a calibration point or a reading which have a 600ms
  * processing/response time.
  *
+ * Rather than waiting the full worst-case processing time, the circuit is
+ * polled for its response code at a bounded cadence.  A finished result is
+ * read as soon as the code changes from "pending" (254).
+ *
+ * The output parameters of each circuit are only changed if the circuit's
+ * current settings don't already match.  On AVR boards, a record of the
+ * settings can also be kept in the EEPROM so that a warm reboot can skip
+ * asking the circuit for its settings at all.  This is off unless
+ * AtlasParent::enableConfigCache() is called in setup, before the sensors are
+ * set up.  The record takes 3 x ATLAS_CONFIG_CACHE_SLOTS bytes (24 bytes by
+ * default) of the EEPROM, starting at the address given, or at the very end
+ * of the EEPROM if none is given, so make sure nothing else keeps its own
+ * data there.  If a circuit is replaced or factory reset, call
+ * clearConfigCache() so its settings are checked again.
+ *
  */
 
 // Header Guards
@@ -30,6 +45,23 @@
 #include "SensorBase.h"
 #include <Wire.h>
 
+// The minimum time between polls of a circuit for a finished command
+#define ATLAS_POLL_INTERVAL_MS 20
+// The largest number of values returned by any Atlas circuit (the EC)
+#define ATLAS_MAX_NUM_VARIABLES 4
+// The largest number of characters expected for a single value, including
+// the separating comma
+#define ATLAS_MAX_CHARS_PER_VALUE 11
+// The maximum length of any response from an Atlas circuit
+#define ATLAS_MAX_RESPONSE_BYTES 40
+
+// The number of circuits whose settings can be recorded in the EEPROM, if
+// enableConfigCache() is called.  Each record takes 3 bytes.
+// NOTE:  Can change the number with build flag -D ATLAS_CONFIG_CACHE_SLOTS=4
+#ifndef ATLAS_CONFIG_CACHE_SLOTS
+#define ATLAS_CONFIG_CACHE_SLOTS 8
+#endif
+
 // A parent class for Atlas sensors
 class AtlasParent : public Sensor
 {
@@ -52,13 +84,60 @@ public:
     virtual bool startSingleMeasurement(void) override;
     virtual bool addSingleMeasurementResult(void) override;
 
+    // This polls the circuit (no more often than every ATLAS_POLL_INTERVAL_MS)
+    // to find out if the measurement is finished before the full measurement
+    // time has passed.  If the measurement is finished, the result is read
+    // and held for addSingleMeasurementResult().
+    virtual bool isMeasurementComplete(bool debug=false) override;
+
+    // This turns on the records of the circuits' settings in the EEPROM, for
+    // all Atlas circuits, starting at the given EEPROM address.  With no
+    // address, the records take the very end of the EEPROM.  Only AVR boards
+    // have the EEPROM to do this; elsewhere it does nothing.
+    static void enableConfigCache(int16_t startAddress = -1);
+    static void disableConfigCache(void);
+    // This forgets the recorded settings of this circuit, so they're checked
+    // with the circuit again the next time it's set up
+    void clearConfigCache(void);
+
 protected:
     int8_t _i2cAddressHex;
+    // The response code and values from the last read of the circuit
+    // A code of 0 means that no response has been read yet
+    uint8_t _responseCode;
+    float _responseValues[ATLAS_MAX_NUM_VARIABLES];
+    uint32_t _millisLastPoll;
+    // Requests only as many bytes as could be needed for the number of
+    // returned values and parses them as they're read.
+    // Returns the response code.
+    uint8_t readResponse(void);
     // Wait for a command to process
     // NOTE:  This should ONLY be used as a wait when no response is
     // expected except a status code - the response will be "consumed"
     // and become unavailable.
     bool waitForProcessing(uint32_t timeout = 1000L);
+
+    // Sends a single command to the circuit
+    bool sendCommand(const char *command);
+    // Waits for a command to process and reads the text of its response
+    bool waitForResponse(char *responseBuffer, uint8_t bufferSize,
+                         uint32_t timeout = 1000L);
+
+    // This makes sure that all of the given output parameters are enabled.
+    // The circuit is asked once for its current output parameters and only
+    // the parameters that are not already enabled are sent.  If
+    // enableConfigCache() was called, once the settings are confirmed they're
+    // recorded in the EEPROM and nothing is sent on later boots unless the
+    // requested parameters change.
+    // The sensor is powered, if needed, only when the settings must be checked.
+    bool enableOutputParameters(const char *const parameters[], uint8_t nParameters);
+
+private:
+    // The EEPROM address of the first record; -1 if the records are off
+    static int16_t _configCacheStart;
+    uint16_t hashOutputParameters(const char *const parameters[], uint8_t nParameters);
+    bool checkConfigCache(uint16_t configHash);
+    void updateConfigCache(uint16_t configHash);
 };
 
 #endif  // Header Guard
@@ -31,18 +31,11 @@ bool AtlasScientificCO2::setup()
 {
     bool success = Sensor::setup();  // this will set pin modes and the setup status bit
 
-    // This sensor needs power for setup!
     // We want to turn on all possible measurement parameters
-    bool wasOn = checkPowerOn();
-    if (!wasOn) {powerUp();}
-    waitForWarmUp();
-
-    MS_DBG(F("Asking"), getSensorNameAndLocation(), F("to report temperature with CO2"));
-    Wire.beginTransmission(_i2cAddressHex);
-    success &= Wire.write((const uint8_t *)"O,t,1", 5);  // Enable temperature
-    success &= !Wire.endTransmission();
-    // NOTE: The return of 0 from endTransmission indicates success
-    success &= waitForProcessing();
+    // NOTE:  This will power the sensor, if needed, to check the settings
+    // Enable temperature
+    static const char *const parameters[] = {"t"};
+    success &= enableOutputParameters(parameters, 1);
 
     if (!success)
     {
@@ -52,8 +45,5 @@ bool AtlasScientificCO2::setup()
         _sensorStatus &= 0b11111110;
     }
 
-    // Turn the power back off it it had been turned on
-    if (!wasOn) {powerDown();}
-
     return success;
 }
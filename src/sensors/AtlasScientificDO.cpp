@@ -31,23 +31,11 @@ bool AtlasScientificDO::setup()
 {
     bool success = Sensor::setup();  // this will set pin modes and the setup status bit
 
-    // This sensor needs power for setup!
     // We want to turn on all possible measurement parameters
-    bool wasOn = checkPowerOn();
-    if (!wasOn) {powerUp();}
-    waitForWarmUp();
-
-    MS_DBG(F("Asking"), getSensorNameAndLocation(), F("to report O2 concentration"));
-    Wire.beginTransmission(_i2cAddressHex);
-    success &= Wire.write((const uint8_t *)"O,mg,1", 6);  // Enable concentration in mg/L
-    success &= !Wire.endTransmission();
-    success &= waitForProcessing();
-
-    MS_DBG(F("Asking"), getSensorNameAndLocation(), F("to report O2 % saturation"));
-    Wire.beginTransmission(_i2cAddressHex);
-    success &= Wire.write((const uint8_t *)"O,%,1", 5);  // Enable percent saturation
-    success &= !Wire.endTransmission();
-    success &= waitForProcessing();
+    // NOTE:  This will power the sensor, if needed, to check the settings
+    // Enable concentration in mg/L and percent saturation
+    static const char *const parameters[] = {"mg", "%"};
+    success &= enableOutputParameters(parameters, 2);
 
     if (!success)
     {
@@ -57,8 +45,5 @@ bool AtlasScientificDO::setup()
         _sensorStatus &= 0b11111110;
     }
 
-    // Turn the power back off it it had been turned on
-    if (!wasOn) {powerDown();}
-
     return success;
 }
@@ -32,35 +32,11 @@ bool AtlasScientificEC::setup()
 {
     bool success = Sensor::setup();  // this will set pin modes and the setup status bit
 
-    // This sensor needs power for setup!
     // We want to turn on all possible measurement parameters
-    bool wasOn = checkPowerOn();
-    if (!wasOn) {powerUp();}
-    waitForWarmUp();
-
-    MS_DBG(F("Asking"), getSensorNameAndLocation(), F("to report conductivity"));
-    Wire.beginTransmission(_i2cAddressHex);
-    success &= Wire.write((const uint8_t *)"O,EC,1", 6);  // Enable conductivity
-    success &= !Wire.endTransmission();
-    success &= waitForProcessing();
-
-    MS_DBG(F("Asking"), getSensorNameAndLocation(), F("to report total dissolved solids"));
-    Wire.beginTransmission(_i2cAddressHex);
-    success &= Wire.write((const uint8_t *)"O,TDS,1", 7);  // Enable total dissolved solids
-    success &= !Wire.endTransmission();
-    success &= waitForProcessing();
-
-    MS_DBG(F("Asking"), getSensorNameAndLocation(), F("to report salinity"));
-    Wire.beginTransmission(_i2cAddressHex);
-    success &= Wire.write((const uint8_t *)"O,S,1", 5);  // Enable salinity
-    success &= !Wire.endTransmission();
-    success &= waitForProcessing();
-
-    MS_DBG(F("Asking"), getSensorNameAndLocation(), F("to report specific gravity"));
-    Wire.beginTransmission(_i2cAddressHex);
-    success &= Wire.write((const uint8_t *)"O,SG,1", 6);  // Enable specific gravity
-    success &= !Wire.endTransmission();
-    success &= waitForProcessing();
+    // NOTE:  This will power the sensor, if needed, to check the settings
+    // Enable conductivity, total dissolved solids, salinity, and specific gravity
+    static const char *const parameters[] = {"EC", "TDS", "S", "SG"};
+    success &= enableOutputParameters(parameters, 4);
 
     if (!success)
     {
@@ -70,8 +46,5 @@ bool AtlasScientificEC::setup()
         _sensorStatus &= 0b11111110;
     }
 
-    // Turn the power back off it it had been turned on
-    if (!wasOn) {powerDown();}
-
     return success;
 }
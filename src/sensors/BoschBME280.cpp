@@ -29,6 +29,13 @@
 */
 
 #include "BoschBME280.h"
+#include <Wire.h>
+
+// The status and measurement control registers
+#define BME280_STATUS_REG 0xF3
+#define BME280_CTRL_MEAS_REG 0xF4
+// The "measuring" bit of the status register
+#define BME280_STATUS_MEASURING 0x08
 
 
 // The constructor - because this is I2C, only need the power pin
@@ -38,11 +45,43 @@ BoschBME280::BoschBME280(int8_t powerPin, uint8_t i2cAddressHex, uint8_t measure
               powerPin, -1, measurementsToAverage)
 {
     _i2cAddressHex  = i2cAddressHex;
+    setOversampling(Adafruit_BME280::SAMPLING_X16,
+                    Adafruit_BME280::SAMPLING_X16,
+                    Adafruit_BME280::SAMPLING_X16);
 }
 // Destructor
 BoschBME280::~BoschBME280(){};
 
 
+// This converts an oversampling setting into the number of samples taken
+static uint8_t bme280OversamplingCount(Adafruit_BME280::sensor_sampling sampling)
+{
+    if (sampling == Adafruit_BME280::SAMPLING_NONE) return 0;
+    return 1 << ((uint8_t)sampling - 1);
+}
+
+
+void BoschBME280::setOversampling(Adafruit_BME280::sensor_sampling tempSampling,
+                                  Adafruit_BME280::sensor_sampling pressSampling,
+                                  Adafruit_BME280::sensor_sampling humidSampling)
+{
+    _tempSampling = tempSampling;
+    _pressSampling = pressSampling;
+    _humidSampling = humidSampling;
+
+    // The maximum measurement time from the datasheet, in µs:
+    // 1250 + 2300*T_os + (2300*P_os + 575) + (2300*H_os + 575)
+    // The pressure and humidity terms are left out if they're skipped.
+    uint32_t time_us = 1250 + 2300*(uint32_t)bme280OversamplingCount(tempSampling);
+    if (pressSampling != Adafruit_BME280::SAMPLING_NONE)
+        time_us += 2300*(uint32_t)bme280OversamplingCount(pressSampling) + 575;
+    if (humidSampling != Adafruit_BME280::SAMPLING_NONE)
+        time_us += 2300*(uint32_t)bme280OversamplingCount(humidSampling) + 575;
+    _measurementTime_ms = (time_us + 999)/1000;
+    MS_DBG(F("BME280 measurement time set to"), _measurementTime_ms, F("ms"));
+}
+
+
 String BoschBME280::getSensorLocation(void)
 {
     String address = F("I2C_0x");
@@ -97,32 +136,73 @@ bool BoschBME280::wake(void)
     // various delays to allow the chip to wake up, get calibrations, get
     // coefficients, and set sampling modes.
     // This will also restart "Wire"
-    // Currently this is using the settings that Adafruit considered to be 'default'
-    //  - sensor mode = normal (sensor measures, sleeps for the "standby time" and then automatically remeasures
-    //  - temperature oversampling = 16x
-    //  - pressure oversampling = 16x
-    //  - humidity oversampling = 16x
-    //  - built-in IIR filter = off
-    //  - sleep time between measurements = 0.5ms
     // TODO:  Figure out why this is necessary; setSampling should be enough
     // this adds a bunch of small delays...
     bme_internal.begin(_i2cAddressHex);
 
-    // When the Adafruit library is updated to remove the built-in delay after
-    // forcing a sample, it would be better to operate in forced mode.
-    bme_internal.setSampling(Adafruit_BME280::MODE_NORMAL,  // sensor mode
-    // bme_internal.setSampling(Adafruit_BME280::MODE_FORCED,  // sensor mode
-                             Adafruit_BME280::SAMPLING_X16,  // temperature oversampling
-                             Adafruit_BME280::SAMPLING_X16,  //  pressure oversampling
-                             Adafruit_BME280::SAMPLING_X16,  //  humidity oversampling
+    // Set the oversampling but leave the sensor asleep; each measurement is
+    // started in forced mode.  Between measurements the sensor draws only its
+    // sleep current rather than continuously measuring as it does in normal mode.
+    bme_internal.setSampling(Adafruit_BME280::MODE_SLEEP,  // sensor mode
+                             _tempSampling,  // temperature oversampling
+                             _pressSampling,  //  pressure oversampling
+                             _humidSampling,  //  humidity oversampling
                              Adafruit_BME280::FILTER_OFF, // built-in IIR filter
                              Adafruit_BME280::STANDBY_MS_1000);  // sleep time between measurements (N/A in forced mode)
-    delay(100);  // Need this delay after changing sampling mode
 
     return true;
 }
 
 
+// This starts a single forced-mode conversion
+bool BoschBME280::startSingleMeasurement(void)
+{
+    // Sensor::startSingleMeasurement() checks that if it's awake/active and sets
+    // the timestamp and status bits.  If it returns false, there's no reason to go on.
+    if (!Sensor::startSingleMeasurement()) return false;
+
+    // Writing the measurement control register with the mode bits set to
+    // forced starts a conversion.  The humidity oversampling was already set
+    // by setSampling and is kept.
+    uint8_t ctrlMeas = ((uint8_t)_tempSampling << 5) | ((uint8_t)_pressSampling << 2) |
+                       (uint8_t)Adafruit_BME280::MODE_FORCED;
+    Wire.beginTransmission(_i2cAddressHex);
+    Wire.write((uint8_t)BME280_CTRL_MEAS_REG);
+    Wire.write(ctrlMeas);
+    if (Wire.endTransmission() != 0)
+    {
+        MS_DBG(getSensorNameAndLocation(), F("did not successfully start a measurement."));
+        _millisMeasurementRequested = 0;
+        _sensorStatus &= 0b10111111;
+        return false;
+    }
+    return true;
+}
+
+
+// The measurement is done as soon as the measuring bit is cleared
+bool BoschBME280::isMeasurementComplete(bool debug)
+{
+    // If a measurement failed to start, the sensor will never return a result
+    if (!bitRead(_sensorStatus, 6)) return true;
+
+    // If the maximum measurement time has passed, stop waiting
+    if (Sensor::isMeasurementComplete(debug)) return true;
+
+    Wire.beginTransmission(_i2cAddressHex);
+    Wire.write((uint8_t)BME280_STATUS_REG);
+    if (Wire.endTransmission() != 0) return false;
+    if (Wire.requestFrom(_i2cAddressHex, (uint8_t)1) != 1) return false;
+    bool measuring = Wire.read() & BME280_STATUS_MEASURING;
+    if (!measuring && debug)
+    {
+        MS_DBG(getSensorNameAndLocation(), F("finished its conversion after"),
+               millis() - _millisMeasurementRequested, F("ms"));
+    }
+    return !measuring;
+}
+
+
 bool BoschBME280::addSingleMeasurementResult(void)
 {
     bool success = false;
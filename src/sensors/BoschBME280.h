@@ -28,6 +28,10 @@
  * Sensor takes about 100ms to respond
  * Slowest response time (humidity): 1sec
  * Assume sensor is immediately stable
+ *
+ * The sensor is run in forced mode:  it takes a single conversion when asked
+ * and then goes back to sleep.  The time for each conversion is calculated
+ * from the oversampling using the formula in section 9.1 of the datasheet.
 */
 
 // Header Guards
@@ -53,6 +57,8 @@
 #define BME280_WARM_UP_TIME_MS 100
 #define BME280_STABILIZATION_TIME_MS 4000   // 0.5 s for good numbers, but optimal at 4 s based on tests using bme280timingTest.ino
 #define BME280_MEASUREMENT_TIME_MS 1100     // 1.0 s according to datasheet, but slightly better stdev when 1.1 s
+// NOTE:  In forced mode the measurement time is instead calculated from the
+// oversampling settings and the measuring bit of the status register is checked.
 // For details on BME280 stabilization time updates, include testing sketch and link to data in Google Sheet,
 //  see https://github.com/EnviroDIY/ModularSensors/commit/27e3cb531162ed6971a41f3c38f5920d356089e9
 
@@ -80,12 +86,24 @@ public:
     bool setup(void) override;
     String getSensorLocation(void) override;
 
-    // bool startSingleMeasurement(void) override;  // for forced mode
+    bool startSingleMeasurement(void) override;  // for forced mode
     bool addSingleMeasurementResult(void) override;
 
+    // This checks the measuring bit of the sensor's status register
+    bool isMeasurementComplete(bool debug=false) override;
+
+    // This sets the oversampling for each channel and recalculates the
+    // measurement time.  SAMPLING_NONE skips that channel.
+    void setOversampling(Adafruit_BME280::sensor_sampling tempSampling,
+                         Adafruit_BME280::sensor_sampling pressSampling,
+                         Adafruit_BME280::sensor_sampling humidSampling);
+
 protected:
     Adafruit_BME280 bme_internal;
     uint8_t _i2cAddressHex;
+    Adafruit_BME280::sensor_sampling _tempSampling;
+    Adafruit_BME280::sensor_sampling _pressSampling;
+    Adafruit_BME280::sensor_sampling _humidSampling;
 };
 
 
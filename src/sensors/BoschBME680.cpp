@@ -43,11 +43,43 @@ BoschBME680::BoschBME680(int8_t powerPin, uint8_t i2cAddressHex, uint8_t measure
               powerPin, -1, measurementsToAverage)
 {
     _i2cAddressHex  = i2cAddressHex;
+    _tempOS = BME680_OS_8X;
+    _pressOS = BME680_OS_4X;
+    _humidOS = BME680_OS_2X;
+    updateMeasurementTime();
 }
 // Destructor
 BoschBME680::~BoschBME680(){};
 
 
+void BoschBME680::setOversampling(uint8_t tempOS, uint8_t pressOS, uint8_t humidOS)
+{
+    _tempOS = tempOS;
+    _pressOS = pressOS;
+    _humidOS = humidOS;
+    bme_internal.setTemperatureOversampling(_tempOS);
+    bme_internal.setPressureOversampling(_pressOS);
+    bme_internal.setHumidityOversampling(_humidOS);
+    updateMeasurementTime();
+}
+
+
+// This follows the profile duration calculation of the Bosch driver
+void BoschBME680::updateMeasurementTime(void)
+{
+    // The number of conversions for each oversampling setting
+    static const uint8_t osToMeasCycles[6] = {0, 1, 2, 4, 8, 16};
+    uint32_t measCycles = osToMeasCycles[min(_tempOS, (uint8_t)5)] +
+                          osToMeasCycles[min(_pressOS, (uint8_t)5)] +
+                          osToMeasCycles[min(_humidOS, (uint8_t)5)];
+    // Each conversion takes 1963µs, plus the switching time for T, P, H and
+    // gas, plus a 0.5ms wake up from sleep
+    uint32_t tphDuration_us = measCycles*1963 + 477*4 + 477*5 + 500;
+    _measurementTime_ms = (tphDuration_us + 500)/1000 + 1 + BME680_DEFAULT_HEATER_TIME_MS;
+    MS_DBG(F("BME680 measurement time set to"), _measurementTime_ms, F("ms"));
+}
+
+
 String BoschBME680::getSensorLocation(void)
 {
     String address = F("I2C_0x");
@@ -58,8 +90,6 @@ String BoschBME680::getSensorLocation(void)
 
 bool BoschBME680::setup(void)
 {
-    // GNOTE: ADD OVERSAMPLING SETUP
-
     bool retVal = Sensor::setup();  // this will set pin modes and the setup status bit
 
     // This sensor needs power for setup!
@@ -90,11 +120,11 @@ bool BoschBME680::setup(void)
     if (!wasOn) {powerDown();}
 
     // Set up oversampling and filter initialization
-    bme_internal.setTemperatureOversampling(BME680_OS_8X);
-    bme_internal.setHumidityOversampling(BME680_OS_2X);
-    bme_internal.setPressureOversampling(BME680_OS_4X);
+    bme_internal.setTemperatureOversampling(_tempOS);
+    bme_internal.setHumidityOversampling(_humidOS);
+    bme_internal.setPressureOversampling(_pressOS);
     bme_internal.setIIRFilterSize(BME680_FILTER_SIZE_3);
-    bme_internal.setGasHeater(320, 150); // 320*C for 150 ms
+    bme_internal.setGasHeater(BME680_DEFAULT_HEATER_TEMP, BME680_DEFAULT_HEATER_TIME_MS);
 
     return retVal;
 }
@@ -107,18 +137,44 @@ bool BoschBME680::wake(void)
     // there's no reason to go on.
     if (!Sensor::wake()) return false;
 
-    // Restart always needed after power-up to set sampling modes
-    // As of Adafruit library version 1.0.7, this function includes all of the
-    // various delays to allow the chip to wake up, get calibrations, get
-    // coefficients, and set sampling modes.
-    // This will also restart "Wire"
-    // Currently this is using the settings that Adafruit considered to be 'default'
+    // The sampling settings are sent to the sensor with each forced-mode
+    // reading, so there's nothing else to do here.
+    return true;
+}
+
 
-    delay(100);//G NOTE: TEST IF NEEDED
+// This starts a single forced-mode conversion
+bool BoschBME680::startSingleMeasurement(void)
+{
+    // Sensor::startSingleMeasurement() checks that if it's awake/active and sets
+    // the timestamp and status bits.  If it returns false, there's no reason to go on.
+    if (!Sensor::startSingleMeasurement()) return false;
+
+    // This sends the settings, starts the conversion and returns without waiting
+    if (bme_internal.beginReading() == 0)
+    {
+        MS_DBG(getSensorNameAndLocation(), F("did not successfully start a measurement."));
+        _millisMeasurementRequested = 0;
+        _sensorStatus &= 0b10111111;
+        return false;
+    }
     return true;
 }
 
 
+bool BoschBME680::isMeasurementComplete(bool debug)
+{
+    // If a measurement failed to start, the sensor will never return a result
+    if (!bitRead(_sensorStatus, 6)) return true;
+
+    // If the calculated measurement time has passed, stop waiting
+    if (Sensor::isMeasurementComplete(debug)) return true;
+
+    // The library tracks its own end time for the reading
+    return bme_internal.remainingReadingMillis() <= 0;
+}
+
+
 bool BoschBME680::addSingleMeasurementResult(void)
 {
     bool success = false;
@@ -135,27 +191,34 @@ bool BoschBME680::addSingleMeasurementResult(void)
     if (bitRead(_sensorStatus, 6))
     {
         MS_DBG(getSensorNameAndLocation(), F("is reporting:"));
-        bme_internal.performReading(); // read values
-        temp = bme_internal.temperature;
-        if (isnan(temp)) temp = -9999;
-        humid = bme_internal.humidity;
-        if (isnan(humid)) humid = -9999;
-        press = bme_internal.pressure;
-        if (isnan(press)) press = -9999;
-        gas = bme_internal.gas_resistance;
-        if (isnan(gas)) gas = -9999;
-
-        // Assume that if all three are 0, really a failed response
-        // May also return a very negative temp when receiving a bad response
-        else if ((temp == 0 && press == 0 && humid == 0 && gas == 0) || temp < -40)
+        // This checks that the new data flag is set before reading the values
+        if (!bme_internal.endReading())
+        {
+            MS_DBG(F("  No new data from the sensor!"));
+        }
+        else
         {
-            MS_DBG(F("All values 0 or bad, assuming sensor non-response!"));
-            temp =  -9999;
-            press = -9999;
-            humid = -9999;
-            gas = -9999;
+            temp = bme_internal.temperature;
+            if (isnan(temp)) temp = -9999;
+            humid = bme_internal.humidity;
+            if (isnan(humid)) humid = -9999;
+            press = bme_internal.pressure;
+            if (isnan(press)) press = -9999;
+            gas = bme_internal.gas_resistance;
+            if (isnan(gas)) gas = -9999;
+
+            // Assume that if all three are 0, really a failed response
+            // May also return a very negative temp when receiving a bad response
+            else if ((temp == 0 && press == 0 && humid == 0 && gas == 0) || temp < -40)
+            {
+                MS_DBG(F("All values 0 or bad, assuming sensor non-response!"));
+                temp =  -9999;
+                press = -9999;
+                humid = -9999;
+                gas = -9999;
+            }
+            else success = true;
         }
-        else success = true;
 
         MS_DBG(F("  Temperature:"), temp, F("°C"));
         MS_DBG(F("  Humidity:"), humid, F("%RH"));
@@ -37,6 +37,9 @@
  * Sensor takes about 100ms to respond
  * Slowest response time (humidity): 8sec
  * Assume sensor is immediately stable
+ *
+ * The sensor is run in forced mode.  The time for each conversion is
+ * calculated from the oversampling and the gas heater duration.
 */
 
 // Header Guards
@@ -61,6 +64,10 @@
 #define BME680_WARM_UP_TIME_MS 100
 #define BME680_STABILIZATION_TIME_MS 1000   // TODO experiment with this value
 #define BME680_MEASUREMENT_TIME_MS 1100     // TODO experiment as done below:
+// NOTE:  In forced mode the measurement time is instead calculated from the
+// oversampling and gas heater settings.
+#define BME680_DEFAULT_HEATER_TEMP 320  // °C
+#define BME680_DEFAULT_HEATER_TIME_MS 150
 
 #define BME680_TEMP_RESOLUTION 2
 #define BME680_TEMP_VAR_NUM 0
@@ -85,12 +92,24 @@ public:
     bool setup(void) override;
     String getSensorLocation(void) override;
 
-    // bool startSingleMeasurement(void) override;  // for forced mode
+    bool startSingleMeasurement(void) override;  // for forced mode
     bool addSingleMeasurementResult(void) override;
 
+    // This checks if the calculated conversion time has passed
+    bool isMeasurementComplete(bool debug=false) override;
+
+    // This sets the oversampling for each channel (BME680_OS_NONE to
+    // BME680_OS_16X) and recalculates the measurement time.
+    void setOversampling(uint8_t tempOS, uint8_t pressOS, uint8_t humidOS);
+
 protected:
     Adafruit_BME680 bme_internal;
     uint8_t _i2cAddressHex;
+    uint8_t _tempOS;
+    uint8_t _pressOS;
+    uint8_t _humidOS;
+
+    void updateMeasurementTime(void);
 };
 
 
@@ -53,6 +53,205 @@
 
 #include "ExternalVoltage.h"
 #include <Adafruit_ADS1015.h>
+#include <Wire.h>
+
+// ADS1x15 registers and configuration bits
+#define ADS1X15_REG_CONVERSION 0x00
+#define ADS1X15_REG_CONFIG 0x01
+#define ADS1X15_REG_LO_THRESH 0x02
+#define ADS1X15_REG_HI_THRESH 0x03
+#define ADS1X15_CONFIG_OS_START 0x8000  // Start a single conversion/conversion done
+#define ADS1X15_CONFIG_MUX_SINGLE_0 0x4000  // Single-ended AIN0, add channel << 12
+#define ADS1X15_CONFIG_PGA_4_096V 0x0200  // 1x gain, +/- 4.096V range
+#define ADS1X15_CONFIG_MODE_SINGLE 0x0100  // Single-shot mode
+#define ADS1X15_CONFIG_CQUE_1CONV 0x0000  // ALERT/RDY after each conversion
+#define ADS1X15_CONFIG_CQUE_NONE 0x0003  // ALERT/RDY disabled
+// With a 1x gain, each bit of the (left justified) result is 0.125 mV
+#define ADS1X15_VOLTS_PER_BIT (4.096/32768.0)
+
+// Conversion times (in µs) for each data rate code
+#ifndef MS_USE_ADS1015
+static const uint32_t ads1x15ConversionTimes_us[8] =
+    {125000, 62500, 31250, 15625, 7813, 4000, 2106, 1163};
+#else
+static const uint32_t ads1x15ConversionTimes_us[8] =
+    {7813, 4000, 2041, 1087, 625, 417, 303, 303};
+#endif
+
+
+// ============================================================================
+//  The class and functions for an ADS1x15 shared by several channels
+// ============================================================================
+
+ExternalVoltageADC::ExternalVoltageADC(uint8_t i2cAddress, uint8_t dataRate, int8_t alertPin)
+{
+    _i2cAddress = i2cAddress;
+    _dataRate = dataRate & 0x07;
+    _alertPin = alertPin;
+    // The internal oscillator can be up to 10% slow, plus a little time to wake
+    _conversionTime_us = ads1x15ConversionTimes_us[_dataRate]*11/10 + 100;
+    _pendingMask = 0;
+    _readyMask = 0;
+    _activeChannel = -1;
+    _lastChannel = ADS1X15_NUM_CHANNELS - 1;
+    _microsConversionStarted = 0;
+    for (uint8_t i = 0; i < ADS1X15_NUM_CHANNELS; i++) _samples[i] = -9999;
+}
+ExternalVoltageADC::~ExternalVoltageADC(){}
+
+
+void ExternalVoltageADC::begin(void)
+{
+    Wire.begin();
+    if (_alertPin >= 0) pinMode(_alertPin, INPUT_PULLUP);
+}
+
+
+// This adds a channel to the queue waiting for a conversion
+bool ExternalVoltageADC::requestSample(uint8_t channel)
+{
+    if (channel >= ADS1X15_NUM_CHANNELS) return false;
+
+    // If the ADC was idle, it may have been powered down since it was last
+    // used, so set the threshold registers needed to use ALERT/RDY again.
+    if (_activeChannel < 0 && _pendingMask == 0 && _alertPin >= 0)
+    {
+        // A high threshold MSB of 1 and low threshold MSB of 0 turns the
+        // ALERT/RDY pin into a conversion ready pin
+        if (!writeRegister(ADS1X15_REG_HI_THRESH, 0x8000) ||
+            !writeRegister(ADS1X15_REG_LO_THRESH, 0x0000))
+        {
+            MS_DBG(F("Unable to set up the ALERT/RDY pin of the ADS1x15 at 0x"),
+                   String(_i2cAddress, HEX));
+            return false;
+        }
+    }
+
+    _readyMask &= ~(1 << channel);
+    _pendingMask |= (1 << channel);
+    service();
+    return true;
+}
+
+
+// This checks on the current conversion and starts the next one
+void ExternalVoltageADC::service(void)
+{
+    if (_activeChannel >= 0)
+    {
+        bool failed = false;
+        if (!isConversionFinished(failed)) return;
+
+        // Don't turn a missing or hung ADC into a reading
+        uint16_t raw;
+        if (failed || !readRegister(ADS1X15_REG_CONVERSION, raw))
+        {
+            MS_DBG(F("No result from channel"), _activeChannel,
+                   F("of the ADS1x15 at 0x"), String(_i2cAddress, HEX));
+            _samples[_activeChannel] = -9999;
+        }
+        else _samples[_activeChannel] = (int16_t)raw * ADS1X15_VOLTS_PER_BIT;
+        _readyMask |= (1 << _activeChannel);
+        _activeChannel = -1;
+    }
+
+    // Start the next channel waiting, going around from the last one used so
+    // every channel gets its turn
+    for (uint8_t i = 1; i <= ADS1X15_NUM_CHANNELS && _pendingMask != 0; i++)
+    {
+        uint8_t channel = (_lastChannel + i) % ADS1X15_NUM_CHANNELS;
+        if (bitRead(_pendingMask, channel))
+        {
+            _pendingMask &= ~(1 << channel);
+            if (startConversion(channel)) return;
+            // If the conversion couldn't be started, mark the sample bad
+            _samples[channel] = -9999;
+            _readyMask |= (1 << channel);
+        }
+    }
+}
+
+
+bool ExternalVoltageADC::isSampleReady(uint8_t channel)
+{
+    return bitRead(_readyMask, channel);
+}
+
+
+float ExternalVoltageADC::getSample(uint8_t channel)
+{
+    if (!isSampleReady(channel)) return -9999;
+    _readyMask &= ~(1 << channel);
+    return _samples[channel];
+}
+
+
+// This starts a single conversion on a channel.
+// Using single-shot conversions, rather than the continuous mode, lets us
+// change channels between conversions without having to discard a result.
+bool ExternalVoltageADC::startConversion(uint8_t channel)
+{
+    uint16_t config = ADS1X15_CONFIG_OS_START |
+                      (ADS1X15_CONFIG_MUX_SINGLE_0 + ((uint16_t)channel << 12)) |
+                      ADS1X15_CONFIG_PGA_4_096V |
+                      ADS1X15_CONFIG_MODE_SINGLE |
+                      ((uint16_t)_dataRate << 5) |
+                      (_alertPin >= 0 ? ADS1X15_CONFIG_CQUE_1CONV : ADS1X15_CONFIG_CQUE_NONE);
+    if (!writeRegister(ADS1X15_REG_CONFIG, config)) return false;
+    _microsConversionStarted = micros();
+    _activeChannel = channel;
+    _lastChannel = channel;
+    return true;
+}
+
+
+// This checks if the current conversion is finished
+bool ExternalVoltageADC::isConversionFinished(bool& failed)
+{
+    uint32_t elapsed = micros() - _microsConversionStarted;
+    // The ALERT/RDY pin is pulled low when the conversion is done
+    if (_alertPin >= 0 && digitalRead(_alertPin) == LOW) return true;
+    // Otherwise, don't bother asking until the conversion should be done
+    if (elapsed < _conversionTime_us) return false;
+    // The OS bit reads as 1 when no conversion is in progress
+    uint16_t config;
+    if (!readRegister(ADS1X15_REG_CONFIG, config)) failed = true;
+    else if (config & ADS1X15_CONFIG_OS_START) return true;
+    // If it's still not done after twice the time, give up on it
+    else if (elapsed > 2*_conversionTime_us) failed = true;
+    return failed;
+}
+
+
+bool ExternalVoltageADC::writeRegister(uint8_t reg, uint16_t value)
+{
+    Wire.beginTransmission(_i2cAddress);
+    Wire.write(reg);
+    Wire.write((uint8_t)(value >> 8));
+    Wire.write((uint8_t)(value & 0xFF));
+    return !Wire.endTransmission();
+}
+
+
+bool ExternalVoltageADC::readRegister(uint8_t reg, uint16_t& value)
+{
+    Wire.beginTransmission(_i2cAddress);
+    Wire.write(reg);
+    if (Wire.endTransmission() != 0) return false;
+    if (Wire.requestFrom(_i2cAddress, (uint8_t)2) < 2)
+    {
+        while (Wire.available()) Wire.read();
+        return false;
+    }
+    value = Wire.read() << 8;
+    value |= Wire.read();
+    return true;
+}
+
+
+// ============================================================================
+//  The class and functions for a single external voltage channel
+// ============================================================================
 
 
 // The constructor - need the power pin the data pin, and gain if non standard
@@ -65,6 +264,22 @@ ExternalVoltage::ExternalVoltage(int8_t powerPin, uint8_t adsChannel, float gain
     _adsChannel = adsChannel;
     _gain = gain;
     _i2cAddress = i2cAddress;
+    _adc = NULL;
+}
+// The constructor for a channel on a shared ADC
+ExternalVoltage::ExternalVoltage(int8_t powerPin, ExternalVoltageADC& adc, uint8_t adsChannel,
+                                 float gain, uint8_t measurementsToAverage)
+    : Sensor("ExternalVoltage", EXT_VOLT_NUM_VARIABLES,
+             EXT_VOLT_WARM_UP_TIME_MS, EXT_VOLT_STABILIZATION_TIME_MS, EXT_VOLT_MEASUREMENT_TIME_MS,
+             powerPin, -1, measurementsToAverage)
+{
+    _adsChannel = adsChannel;
+    _gain = gain;
+    _i2cAddress = adc.getI2CAddress();
+    _adc = &adc;
+    // Allow time for every other channel to have its turn on the shared ADC
+    // before this measurement is given up on.
+    _measurementTime_ms = (adc.getConversionTime_us()*2*ADS1X15_NUM_CHANNELS)/1000 + 1;
 }
 // Destructor
 ExternalVoltage::~ExternalVoltage(){}
@@ -84,6 +299,49 @@ String ExternalVoltage::getSensorLocation(void)
 }
 
 
+bool ExternalVoltage::setup(void)
+{
+    if (_adc != NULL) _adc->begin();
+    return Sensor::setup();  // this will set pin modes and the setup status bit
+}
+
+
+// For a channel on a shared ADC, this puts the channel in line for a conversion
+bool ExternalVoltage::startSingleMeasurement(void)
+{
+    // Sensor::startSingleMeasurement() checks that if it's awake/active and sets
+    // the timestamp and status bits.  If it returns false, there's no reason to go on.
+    if (!Sensor::startSingleMeasurement()) return false;
+    if (_adc == NULL) return true;
+
+    bool success = _adc->requestSample(_adsChannel);
+    if (!success)
+    {
+        MS_DBG(getSensorNameAndLocation(), F("did not successfully start a measurement."));
+        _millisMeasurementRequested = 0;
+        _sensorStatus &= 0b10111111;
+    }
+    return success;
+}
+
+
+// For a channel on a shared ADC, this keeps the ADC moving and checks for a sample
+bool ExternalVoltage::isMeasurementComplete(bool debug)
+{
+    // Without a shared ADC, the reading is taken in addSingleMeasurementResult
+    if (_adc == NULL) return Sensor::isMeasurementComplete(debug);
+
+    // If a measurement failed to start, the sensor will never return a result
+    if (!bitRead(_sensorStatus, 6)) return true;
+
+    _adc->service();
+    if (_adc->isSampleReady(_adsChannel)) return true;
+
+    // Give up if it's taken far longer than the ADC should ever need
+    return millis() - _millisMeasurementRequested > _measurementTime_ms;
+}
+
+
 bool ExternalVoltage::addSingleMeasurementResult(void)
 {
     // Variables to store the results in
@@ -92,7 +350,25 @@ bool ExternalVoltage::addSingleMeasurementResult(void)
 
     // Check a measurement was *successfully* started (status bit 6 set)
     // Only go on to get a result if it was
-    if (bitRead(_sensorStatus, 6))
+    if (bitRead(_sensorStatus, 6) && _adc != NULL)
+    {
+        MS_DBG(getSensorNameAndLocation(), F("is reporting:"));
+
+        // The sample has already been taken by the shared ADC
+        adcVoltage = _adc->getSample(_adsChannel);
+        MS_DBG(F("  Shared ADC sample:"), adcVoltage);
+
+        if (adcVoltage < 3.6 and adcVoltage > -0.3)  // Skip results out of range
+        {
+            calibResult = adcVoltage * _gain ;
+            MS_DBG(F("  calibResult:"), calibResult);
+        }
+        else  // set invalid voltages back to -9999
+        {
+            adcVoltage = -9999;
+        }
+    }
+    else if (bitRead(_sensorStatus, 6))
     {
         MS_DBG(getSensorNameAndLocation(), F("is reporting:"));
 
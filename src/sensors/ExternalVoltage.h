@@ -48,6 +48,14 @@
  *
  * Response time: < 1ms
  * Resample time: max of ADC (860/sec)
+ *
+ * Several ExternalVoltage channels on the same ADS1x15 can share an
+ * ExternalVoltageADC.  The shared ADC takes conversions back-to-back on
+ * every channel with a pending request, rotating between them, without ever
+ * blocking the update loop.  Finished conversions are found either with the
+ * ADS1x15's ALERT/RDY pin or by polling the ADC once the conversion time has
+ * passed.  The data rate is configurable; at the lower data rates the ADC's
+ * delta-sigma converter averages over a longer period, reducing noise.
 */
 
 // Header Guards
@@ -85,6 +93,65 @@
 #define EXT_VOLT_RESOLUTION 4
 #endif
 
+// The ADS1x15 data rate codes, from slowest (0) to fastest (7)
+// ADS1115: 8, 16, 32, 64, 128, 250, 475, 860 samples per second
+// ADS1015: 128, 250, 490, 920, 1600, 2400, 3300, 3300 samples per second
+#define ADS1X15_DR_DEFAULT 7
+// The ADS1x15 has four single-ended channels
+#define ADS1X15_NUM_CHANNELS 4
+
+
+// A class for an ADS1x15 shared by several ExternalVoltage channels
+// NOTE:  The ADC object must be created BEFORE any sensors that use it
+class ExternalVoltageADC
+{
+public:
+    // The ALERT/RDY pin is optional; if it is not given the ADC will be
+    // asked if a conversion is finished once the conversion time has passed.
+    ExternalVoltageADC(uint8_t i2cAddress = ADS1115_ADDRESS,
+                       uint8_t dataRate = ADS1X15_DR_DEFAULT, int8_t alertPin = -1);
+    ~ExternalVoltageADC();
+
+    uint8_t getI2CAddress(void){return _i2cAddress;}
+    // The time a single conversion takes at the set data rate, with margin
+    uint32_t getConversionTime_us(void){return _conversionTime_us;}
+
+    // This sets the pin mode for the ALERT/RDY pin
+    void begin(void);
+
+    // This adds a channel to the queue of channels waiting for a conversion
+    bool requestSample(uint8_t channel);
+    // This checks on the current conversion and starts the next one.  It
+    // must be called repeatedly (each sensor calls it while waiting for its
+    // measurement) for the conversions to continue.
+    void service(void);
+    // This checks if a new sample is ready for a channel
+    bool isSampleReady(uint8_t channel);
+    // This returns the latest sample for a channel in volts and marks it as
+    // read; -9999 is returned if there is no new sample
+    float getSample(uint8_t channel);
+
+private:
+    uint8_t _i2cAddress;
+    uint8_t _dataRate;
+    int8_t _alertPin;
+    uint32_t _conversionTime_us;
+    uint8_t _pendingMask;
+    uint8_t _readyMask;
+    int8_t _activeChannel;
+    uint8_t _lastChannel;
+    uint32_t _microsConversionStarted;
+    float _samples[ADS1X15_NUM_CHANNELS];
+
+    bool startConversion(uint8_t channel);
+    // failed is set if the conversion timed out or the ADC didn't answer
+    bool isConversionFinished(bool& failed);
+    bool writeRegister(uint8_t reg, uint16_t value);
+    // Returns false if the ADC didn't answer with both bytes
+    bool readRegister(uint8_t reg, uint16_t& value);
+};
+
+
 // The main class for the external votlage monitor
 class ExternalVoltage : public Sensor
 {
@@ -95,17 +162,28 @@ public:
     // If nothing is given a 1x gain is used.
     ExternalVoltage(int8_t powerPin, uint8_t adsChannel, float gain = 1,
                     uint8_t i2cAddress = ADS1115_ADDRESS, uint8_t measurementsToAverage = 1);
+    // The constructor for a channel on a shared ADC
+    ExternalVoltage(int8_t powerPin, ExternalVoltageADC& adc, uint8_t adsChannel,
+                    float gain = 1, uint8_t measurementsToAverage = 1);
     // Destructor
     ~ExternalVoltage();
 
     String getSensorLocation(void) override;
 
+    bool setup(void) override;
+
+    bool startSingleMeasurement(void) override;
     bool addSingleMeasurementResult(void) override;
 
+    // For a channel on a shared ADC, this keeps the shared ADC moving and
+    // checks if a sample for this channel is ready.
+    bool isMeasurementComplete(bool debug=false) override;
+
 protected:
     uint8_t _adsChannel;
     float _gain;
     uint8_t _i2cAddress;
+    ExternalVoltageADC *_adc;
 };
 
 
@@ -16,6 +16,7 @@
 */
 
 #include "KellerParent.h"
+#include "SensorTelemetry.h"
 
 // The constructor - need the sensor type, modbus address, power pin, stream for data, and number of readings to average
 KellerParent::KellerParent(byte modbusAddress, Stream* stream,
@@ -85,9 +86,9 @@ void KellerParent::powerUp(void)
     {
         MS_DBG(F("Powering"), getSensorNameAndLocation(),
                F("with pin"), _powerPin);
-        digitalWrite(_powerPin, HIGH);
-        // Mark the time that the sensor was powered
-        _millisPowerOn = millis();
+        // Mark the time that the sensor was powered - or that the rail it
+        // shares came up, if it was already on
+        holdPower();
     }
     if (_powerPin2 >= 0)
     {
@@ -100,6 +101,7 @@ void KellerParent::powerUp(void)
         MS_DBG(F("Power to"), getSensorNameAndLocation(),
                F("is not controlled by this library."));
     }
+    if (_telemetry != NULL) _telemetry->powerOn(millis());
     // Set the status bit for sensor power attempt (bit 1) and success (bit 2)
     _sensorStatus |= 0b00000110;
 }
@@ -112,7 +114,8 @@ void KellerParent::powerDown(void)
     {
         MS_DBG(F("Turning off power to"), getSensorNameAndLocation(),
                F("with pin"), _powerPin);
-        digitalWrite(_powerPin, LOW);
+        releasePower();
+        if (_telemetry != NULL) _telemetry->powerOff(millis());
         // Unset the power-on time
         _millisPowerOn = 0;
         // Unset the activation time
@@ -21,6 +21,12 @@ MaxBotixSonar::MaxBotixSonar(Stream* stream, int8_t powerPin, int8_t triggerPin,
 {
     _triggerPin = triggerPin;
     _stream = stream;
+    _framesPerResult = HRXL_DEFAULT_FRAMES_PER_RESULT;
+    _numGoodFrames = 0;
+    _numFrames = 0;
+    _frameValue = 0;
+    _frameDigits = -1;
+    _millisLastFrame = 0;
 }
 MaxBotixSonar::MaxBotixSonar(Stream& stream, int8_t powerPin, int8_t triggerPin, uint8_t measurementsToAverage)
     : Sensor("MaxBotixMaxSonar", HRXL_NUM_VARIABLES,
@@ -29,6 +35,12 @@ MaxBotixSonar::MaxBotixSonar(Stream& stream, int8_t powerPin, int8_t triggerPin,
 {
     _triggerPin = triggerPin;
     _stream = &stream;
+    _framesPerResult = HRXL_DEFAULT_FRAMES_PER_RESULT;
+    _numGoodFrames = 0;
+    _numFrames = 0;
+    _frameValue = 0;
+    _frameDigits = -1;
+    _millisLastFrame = 0;
 }
 // Destructor
 MaxBotixSonar::~MaxBotixSonar(){}
@@ -54,7 +66,7 @@ bool MaxBotixSonar::setup(void)
 
     // Set the stream timeout;
     // Even the slowest sensors should respond at a rate of 6Hz (166ms).
-    _stream->setTimeout(180);
+    _stream->setTimeout(HRXL_FRAME_TIMEOUT_MS);
 
     return Sensor::setup();  // this will set pin modes and the setup status bit
 }
@@ -89,6 +101,90 @@ bool MaxBotixSonar::wake(void)
         MS_DBG(i, '-', headerLine);
     }
     // Clear anything else out of the stream buffer
+    dumpBuffer();
+
+    return true;
+}
+
+
+void MaxBotixSonar::setFramesPerResult(uint8_t framesPerResult)
+{
+    _framesPerResult = constrain(framesPerResult, 1, HRXL_MAX_FRAMES_PER_RESULT);
+}
+
+
+bool MaxBotixSonar::startSingleMeasurement(void)
+{
+    // Sensor::startSingleMeasurement() checks that if it's awake/active and sets
+    // the timestamp and status bits.  If it returns false, there's no reason to go on.
+    if (!Sensor::startSingleMeasurement()) return false;
+
+    // Throw out anything left over from before this measurement and start
+    // collecting frames fresh
+    dumpBuffer();
+    _numGoodFrames = 0;
+    _numFrames = 0;
+    _frameDigits = -1;
+    _millisLastFrame = millis();
+
+    triggerSonar();
+    return true;
+}
+
+
+bool MaxBotixSonar::isMeasurementComplete(bool debug)
+{
+    // If a measurement failed to start, the sensor will never return a result
+    if (!bitRead(_sensorStatus, 6)) return true;
+
+    parseFrames();
+
+    if (_numGoodFrames >= _framesPerResult)
+    {
+        if (debug) MS_DBG(getSensorNameAndLocation(), F("has"), _numGoodFrames, F("good frames."));
+        return true;
+    }
+    if (_numFrames >= HRXL_MAX_FRAME_ATTEMPTS)
+    {
+        if (debug) MS_DBG(getSensorNameAndLocation(), F("gave up after"), _numFrames, F("frames."));
+        return true;
+    }
+
+    // If no frame arrived in time, the trigger may have been missed or the
+    // sonar may have gone quiet.  Count it as a bad attempt and try again.
+    if (millis() - _millisLastFrame > HRXL_FRAME_TIMEOUT_MS)
+    {
+        MS_DBG(F("  No frame received from sonar, Retry Attempt #"), _numFrames + 1);
+        _numFrames++;
+        _frameDigits = -1;
+        _millisLastFrame = millis();
+        triggerSonar();
+        // Don't wait out the whole attempt limit on a silent sonar
+        if (_numFrames >= 3 && _numGoodFrames == 0 && _stream->available() == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// If the sonar is running on a trigger, this asks for the next frame
+void MaxBotixSonar::triggerSonar(void)
+{
+    if (_triggerPin >= 0)
+    {
+        MS_DBG(F("  Triggering Sonar with"), _triggerPin);
+        digitalWrite(_triggerPin, HIGH);
+        delayMicroseconds(30);  // Trigger must be held high for >20 µs
+        digitalWrite(_triggerPin, LOW);
+    }
+}
+
+
+// This clears anything out of the stream buffer
+void MaxBotixSonar::dumpBuffer(void)
+{
     uint8_t junkChars = _stream->available();
     if (junkChars)
     {
@@ -105,8 +201,74 @@ bool MaxBotixSonar::wake(void)
         DEBUGGING_SERIAL_OUTPUT.println();
         #endif
     }
+}
 
-    return true;
+
+// This reads whatever bytes are waiting and picks out the "R####\r" frames.
+// Nothing here waits for the stream; a partial frame is finished next time.
+void MaxBotixSonar::parseFrames(void)
+{
+    while (_stream->available())
+    {
+        char c = _stream->read();
+        if (c == 'R')
+        {
+            // The start of a new frame
+            _frameValue = 0;
+            _frameDigits = 0;
+        }
+        else if (c >= '0' && c <= '9' && _frameDigits >= 0)
+        {
+            _frameValue = _frameValue*10 + (c - '0');
+            _frameDigits++;
+            // A range never has more than 4 digits; this is garbage
+            if (_frameDigits > 4) _frameDigits = -1;
+        }
+        else if (c == '\r' && _frameDigits > 0)
+        {
+            addFrame(_frameValue);
+            _frameDigits = -1;
+            _millisLastFrame = millis();
+            // Ask for the next frame
+            if (_numGoodFrames < _framesPerResult) triggerSonar();
+        }
+        else
+        {
+            // Anything else (a header line, a garbled frame) is thrown out
+            _frameDigits = -1;
+        }
+    }
+}
+
+
+// This checks a range and keeps it in order with the other good ones
+void MaxBotixSonar::addFrame(int16_t range)
+{
+    _numFrames++;
+    MS_DBG(F("  Sonar Range:"), range);
+
+    // If it cannot obtain a result , the sonar is supposed to send a value
+    // just above it's max range.  For 10m models, this is 9999, for 5m models
+    // it's 4999.  The sonar might also send readings of 300 or 500 (the
+    // blanking distance) if there are too many acoustic echos.
+    // A garbled frame can also read as 0.  Luckily, these sensors are not
+    // capable of reading 0, so we also know the 0 value is bad.
+    if (range <= 300 || range == 500 || range == 4999 || range == 9999)
+    {
+        MS_DBG(F("  Bad or Suspicious Result, Retry Attempt #"), _numFrames);
+        return;
+    }
+    if (_numGoodFrames >= HRXL_MAX_FRAMES_PER_RESULT) return;
+
+    // Insertion sort - there are never more than a handful of frames
+    uint8_t i = _numGoodFrames;
+    while (i > 0 && _goodFrames[i - 1] > range)
+    {
+        _goodFrames[i] = _goodFrames[i - 1];
+        i--;
+    }
+    _goodFrames[i] = range;
+    _numGoodFrames++;
 }
 
 
@@ -114,74 +276,28 @@ bool MaxBotixSonar::addSingleMeasurementResult(void)
 {
     // Initialize values
     bool success = false;
-    uint8_t rangeAttempts = 0;
     int16_t result = -9999;
 
-    // Clear anything out of the stream buffer
-    uint8_t junkChars = _stream->available();
-    if (junkChars)
-    {
-        MS_DBG(F("Dumping"), junkChars, F("characters from MaxBotix stream buffer:"));
-        for (uint8_t i = 0; i < junkChars; i++)
-        {
-            #ifdef MS_MAXBOTIXSONAR_DEBUG
-            DEBUGGING_SERIAL_OUTPUT.print(_stream->read());
-            #else
-            _stream->read();
-            #endif
-        }
-        #ifdef MS_MAXBOTIXSONAR_DEBUG
-        DEBUGGING_SERIAL_OUTPUT.println();
-        #endif
-    }
-
     // Check a measurement was *successfully* started (status bit 6 set)
     // Only go on to get a result if it was
     if (bitRead(_sensorStatus, 6))
     {
         MS_DBG(getSensorNameAndLocation(), F("is reporting:"));
 
-        while (success == false && rangeAttempts < 25)
+        // Pick up any frames that came in since the last check
+        parseFrames();
+
+        // Use the median of the good frames; it's much less sensitive to the
+        // odd stray echo than the first acceptable frame would be.
+        if (_numGoodFrames > 0)
         {
-             // If the sonar is running on a trigger, activating the trigger
-             // should in theory happen within the startSingleMeasurement
-             // function.  Because we're really taking up to 25 measurements
-             // for each "single measurement" until a valid value is returned
-             // and the measurement time is <166ms, we'll actually activate
-             // the trigger here.
-            if (_triggerPin >= 0)
-            {
-                MS_DBG(F("  Triggering Sonar with"), _triggerPin);
-                digitalWrite(_triggerPin, HIGH);
-                delayMicroseconds(30);  // Trigger must be held high for >20 µs
-                digitalWrite(_triggerPin, LOW);
-            }
-
-            // Immediately ask for a result and let the stream timeout be our
-            // "wait" for the measurement.
-            result = _stream->parseInt();
-            _stream->read();  // To throw away the carriage return
-            MS_DBG(F("  Sonar Range:"), result);
-            rangeAttempts++;
-
-            // If it cannot obtain a result , the sonar is supposed to send a value
-            // just above it's max range.  For 10m models, this is 9999, for 5m models
-            // it's 4999.  The sonar might also send readings of 300 or 500 (the
-            // blanking distance) if there are too many acoustic echos.
-            // If the result becomes garbled or the sonar is disconnected, the
-            // parseInt function returns 0.  Luckily, these sensors are not
-            // capable of reading 0, so we also know the 0 value is bad.
-            if (result <= 300 || result == 500 || result == 4999 || result == 9999 || result == 0)
-            {
-                MS_DBG(F("  Bad or Suspicious Result, Retry Attempt #"), rangeAttempts);
-                result = -9999;
-            }
-            else
-            {
-                MS_DBG(F("  Good result found"));
-                success = true;
-            }
+            uint8_t mid = _numGoodFrames/2;
+            if (_numGoodFrames % 2) result = _goodFrames[mid];
+            else result = (_goodFrames[mid - 1] + _goodFrames[mid])/2;
+            MS_DBG(F("  Median of"), _numGoodFrames, F("good frames:"), result);
+            success = true;
         }
+        else MS_DBG(F("  No good frames in"), _numFrames, F("attempts"));
     }
     else MS_DBG(getSensorNameAndLocation(), F("is not currently measuring!"));
 
@@ -11,6 +11,11 @@
  *     Range is 300-5000mm or 500 to 9999mm, depending on model
  *
  * Warm up time to completion of header:  160ms
+ *
+ * The sonar sends frames of "R####\r" either continuously (~6Hz) or once per
+ * trigger.  The frames are parsed a byte at a time as they arrive while the
+ * update loop is waiting on other sensors.  The result for each "single
+ * measurement" is the median of several good frames.
  */
 
 // Header Guards
@@ -37,6 +42,13 @@
 #define HRXL_MEASUREMENT_TIME_MS 166
 #define HRXL_RESOLUTION 0
 #define HRXL_VAR_NUM 0
+// The number of good frames to take the median of for each result
+#define HRXL_DEFAULT_FRAMES_PER_RESULT 3
+#define HRXL_MAX_FRAMES_PER_RESULT 9
+// The maximum number of frames (good or bad) to wait for for each result
+#define HRXL_MAX_FRAME_ATTEMPTS 25
+// Even the slowest sensors should send a frame within 180ms
+#define HRXL_FRAME_TIMEOUT_MS 180
 
 // The main class for the MaxBotix Sonar
 class MaxBotixSonar : public Sensor
@@ -51,11 +63,35 @@ public:
     bool setup(void) override;
     bool wake(void) override;
 
+    bool startSingleMeasurement(void) override;
     bool addSingleMeasurementResult(void) override;
 
+    // This parses any frames waiting in the stream and returns true once
+    // enough good frames have been collected or too many have been bad.
+    bool isMeasurementComplete(bool debug=false) override;
+
+    // The number of good frames to take the median of for each result
+    void setFramesPerResult(uint8_t framesPerResult);
+    uint8_t getFramesPerResult(void){return _framesPerResult;}
+
 private:
     int8_t _triggerPin;
     Stream* _stream;
+
+    uint8_t _framesPerResult;
+    // The good ranges from this measurement, kept in order
+    int16_t _goodFrames[HRXL_MAX_FRAMES_PER_RESULT];
+    uint8_t _numGoodFrames;
+    uint8_t _numFrames;
+    // The state of the frame being parsed; -1 digits is between frames
+    int16_t _frameValue;
+    int8_t _frameDigits;
+    uint32_t _millisLastFrame;
+
+    void triggerSonar(void);
+    void dumpBuffer(void);
+    void parseFrames(void);
+    void addFrame(int16_t range);
 };
 
 
@@ -20,29 +20,158 @@
 #include "MaximDS18.h"
 
 
+// ============================================================================
+//  The class and functions for a OneWire bus shared by many DS18's
+// ============================================================================
+
+// The constructor - need the power pin and the data pin
+MaximDS18Bus::MaximDS18Bus(int8_t powerPin, int8_t dataPin)
+  : _busOneWire(dataPin), _busDallasTemp(&_busOneWire)
+{
+    _powerPin = powerPin;
+    _dataPin = dataPin;
+    _searched = false;
+    _deviceCount = 0;
+    _conversionNumber = 0;
+    _millisConversionStarted = 0;
+}
+// Destructor
+MaximDS18Bus::~MaximDS18Bus(){}
+
+
+// This searches the bus for all attached devices, but only once
+bool MaximDS18Bus::begin(void)
+{
+    if (_searched) return _deviceCount > 0;
+
+    _busDallasTemp.begin();
+    // Tell the sensors that we do NOT want to wait for conversions to finish
+    // That is, we're in ASYNC mode and will get values when we're ready
+    _busDallasTemp.setWaitForConversion(false);
+
+    // Keep the addresses of everything we found
+    _deviceCount = 0;
+    DeviceAddress address;
+    _busOneWire.reset_search();
+    while (_deviceCount < DS18_BUS_MAX_DEVICES && _busOneWire.search(address))
+    {
+        if (_busDallasTemp.validAddress(address))
+        {
+            for (uint8_t i = 0; i < 8; i++)
+                _deviceAddresses[_deviceCount][i] = address[i];
+            _deviceCount++;
+        }
+    }
+    MS_DBG(F("Found"), _deviceCount, F("devices on OneWire bus on pin"), _dataPin);
+
+    // Only mark the search as done if something was found, so a bus that was
+    // not yet powered can be searched again
+    _searched = _deviceCount > 0;
+    return _searched;
+}
+
+
+// This checks if a device was found at the given address
+bool MaximDS18Bus::isPresent(DeviceAddress OneWireAddress)
+{
+    for (uint8_t i = 0; i < _deviceCount; i++)
+    {
+        if (memcmp(_deviceAddresses[i], OneWireAddress, 8) == 0) return true;
+    }
+    return false;
+}
+
+
+// This starts a temperature conversion on every device on the bus at once
+bool MaximDS18Bus::requestConversion(uint16_t& conversionNumber)
+{
+    // Join the current conversion if the caller hasn't already read it and
+    // it is either still running or has only recently finished
+    uint32_t elapsed = millis() - _millisConversionStarted;
+    if (_conversionNumber != 0 && conversionNumber != _conversionNumber &&
+        elapsed < DS18_MEASUREMENT_TIME_MS + DS18_BUS_RESULT_EXPIRY_MS)
+    {
+        MS_DBG(F("Joining conversion"), _conversionNumber, F("started"),
+               elapsed, F("ms ago on OneWire bus on pin"), _dataPin);
+        conversionNumber = _conversionNumber;
+        return true;
+    }
+
+    // Otherwise, send a single Skip-ROM Convert T to every device
+    // The reset returns false if no devices answer with a presence pulse
+    if (!_busOneWire.reset())
+    {
+        MS_DBG(F("No devices responded on OneWire bus on pin"), _dataPin);
+        return false;
+    }
+    _busOneWire.skip();
+    _busOneWire.write(STARTCONVO, _busDallasTemp.isParasitePowerMode());
+
+    _millisConversionStarted = millis();
+    _conversionNumber++;
+    if (_conversionNumber == 0) _conversionNumber = 1;  // 0 means "none read"
+    MS_DBG(F("Started conversion"), _conversionNumber,
+           F("on all devices on OneWire bus on pin"), _dataPin);
+    conversionNumber = _conversionNumber;
+    return true;
+}
+
+
+// ============================================================================
+//  The class and functions for a single DS18
+// ============================================================================
+
 // The constructor - if the hex address is known - also need the power pin and the data pin
 MaximDS18::MaximDS18(DeviceAddress OneWireAddress, int8_t powerPin, int8_t dataPin, uint8_t measurementsToAverage)
   : Sensor("MaximDS18", DS18_NUM_VARIABLES,
            DS18_WARM_UP_TIME_MS, DS18_STABILIZATION_TIME_MS, DS18_MEASUREMENT_TIME_MS,
-           powerPin, dataPin, measurementsToAverage),
-    _internalOneWire(dataPin), _internalDallasTemp(&_internalOneWire)
+           powerPin, dataPin, measurementsToAverage)
 {
     for (uint8_t i = 0; i < 8; i++) _OneWireAddress[i] = OneWireAddress[i];
     // _OneWireAddress = OneWireAddress;
     _addressKnown = true;
+    _bus = NULL;
+    _busConversion = 0;
+    _aloneOnPin = false;
+    _internalWire = new MaximDS18Wire(dataPin);
+    _dallasTemp = &_internalWire->dallasTemp;
+    setBitResolution(DS18_DEFAULT_BIT_RESOLUTION);
 }
 // The constructor - if the hex address is NOT known - only need the power pin and the data pin
 // Can only use this if there is only a single sensor on the pin
 MaximDS18::MaximDS18(int8_t powerPin, int8_t dataPin, uint8_t measurementsToAverage)
   : Sensor("MaximDS18", DS18_NUM_VARIABLES,
            DS18_WARM_UP_TIME_MS, DS18_STABILIZATION_TIME_MS, DS18_MEASUREMENT_TIME_MS,
-           powerPin, dataPin, measurementsToAverage),
-    _internalOneWire(dataPin), _internalDallasTemp(&_internalOneWire)
+           powerPin, dataPin, measurementsToAverage)
 {
     _addressKnown = false;
+    _bus = NULL;
+    _busConversion = 0;
+    _aloneOnPin = false;
+    _internalWire = new MaximDS18Wire(dataPin);
+    _dallasTemp = &_internalWire->dallasTemp;
+    setBitResolution(DS18_DEFAULT_BIT_RESOLUTION);
+}
+// The constructor - for a sensor with a known address on a shared bus
+MaximDS18::MaximDS18(DeviceAddress OneWireAddress, MaximDS18Bus& bus, uint8_t measurementsToAverage)
+  : Sensor("MaximDS18", DS18_NUM_VARIABLES,
+           DS18_WARM_UP_TIME_MS, DS18_STABILIZATION_TIME_MS, DS18_MEASUREMENT_TIME_MS,
+           bus.getPowerPin(), bus.getDataPin(), measurementsToAverage)
+{
+    for (uint8_t i = 0; i < 8; i++) _OneWireAddress[i] = OneWireAddress[i];
+    _addressKnown = true;
+    _internalWire = NULL;
+    _bus = &bus;
+    _busConversion = 0;
+    _aloneOnPin = false;
+    _dallasTemp = bus.getDallasTemperature();
+    setBitResolution(DS18_DEFAULT_BIT_RESOLUTION);
 }
 // Destructor
-MaximDS18::~MaximDS18(){}
+MaximDS18::~MaximDS18()
+{
+    if (_internalWire != NULL) delete _internalWire;
+}
 
 
 // Turns the address into a printable string
@@ -71,6 +200,16 @@ String MaximDS18::getSensorLocation(void)
 }
 
 
+// This sets the bit resolution and the measurement time that goes with it
+// Time to take reading is 93.75ms at 9-bit, 187.5ms at 10-bit, 375ms at 11-bit
+// and 750ms at 12-bit
+void MaximDS18::setBitResolution(uint8_t bitResolution)
+{
+    _bitResolution = constrain(bitResolution, 9, 12);
+    _measurementTime_ms = (DS18_MEASUREMENT_TIME_MS >> (12 - _bitResolution)) + 1;
+}
+
+
 // The function to set up connection to a sensor.
 // By default, sets pin modes and returns ready
 bool MaximDS18::setup(void)
@@ -84,11 +223,28 @@ bool MaximDS18::setup(void)
     if (!wasOn) {powerUp();}
     waitForWarmUp();
 
-    _internalDallasTemp.begin();
-
+    // If on a shared bus, the bus does a single search for every sensor and
+    // we only need to check that this sensor was found in that search
+    if (_bus != NULL)
+    {
+        if (!_bus->begin())
+        {
+            MS_DBG(F("Unable to find any devices on OneWire bus on pin"), _dataPin);
+            retVal = false;
+        }
+        else if (!_bus->isPresent(_OneWireAddress))
+        {
+            MS_DBG(F("This sensor was not found on the bus:"),
+                   makeAddressString(_OneWireAddress));
+            retVal = false;
+        }
+    }
     // Find the address if it's not known
-    if (!_addressKnown)
+    else if (!_addressKnown)
     {
+        _internalWire->dallasTemp.begin();
+        _aloneOnPin = _internalWire->dallasTemp.getDeviceCount() == 1;
+
         MS_DBG(F("Address of DS18 on pin"), _dataPin, F("is not known!"));
 
         DeviceAddress address;  // create a variable to put the found address into
@@ -97,7 +253,7 @@ bool MaximDS18::setup(void)
         // Try 5 times to get an address
         while (!gotAddress and ntries <5)
         {
-            gotAddress = _internalOneWire.search(address);
+            gotAddress = _internalWire->oneWire.search(address);
             ntries++;
         }
         if (gotAddress)
@@ -115,7 +271,10 @@ bool MaximDS18::setup(void)
     // If the address is known, make sure the given address is valid
     else
     {
-        if (!_internalDallasTemp.validAddress(_OneWireAddress))
+        _internalWire->dallasTemp.begin();
+        _aloneOnPin = _internalWire->dallasTemp.getDeviceCount() == 1;
+
+        if (!_internalWire->dallasTemp.validAddress(_OneWireAddress))
         {
             MS_DBG(F("This sensor address is not valid:"),
                    makeAddressString(_OneWireAddress));
@@ -127,7 +286,7 @@ bool MaximDS18::setup(void)
         bool madeConnection = false;
         while (retVal && !madeConnection && ntries <5)
         {
-            madeConnection = _internalDallasTemp.isConnected(_OneWireAddress);
+            madeConnection = _internalWire->dallasTemp.isConnected(_OneWireAddress);
             ntries++;
         }
         if (!madeConnection)
@@ -138,19 +297,32 @@ bool MaximDS18::setup(void)
         }
     }
 
-    // Set resolution to 12 bit
-    // All variable resolution sensors start up at 12 bit resolution by default
-    if (!_internalDallasTemp.setResolution(_OneWireAddress, 12))
+    // Set the resolution, but only if it's different from the stored value.
+    // Writing the scratchpad also copies it to the sensor's EEPROM, which
+    // takes time and wears the EEPROM for no reason if nothing changed.
+    // The DS18S20 is fixed at 9 bits but still takes the full 750ms.
+    if (_OneWireAddress[0] == DS18S20MODEL)
     {
-        MS_DBG(F("Unable to set the resolution of this sensor:"),
+        MS_DBG(F("The resolution of this sensor cannot be changed:"),
                makeAddressString(_OneWireAddress));
-        // We're not setting the error bit if this fails because not all sensors
-        // have variable resolution.
+        _measurementTime_ms = DS18_MEASUREMENT_TIME_MS;
+    }
+    else if (retVal && _dallasTemp->getResolution(_OneWireAddress) != _bitResolution)
+    {
+        MS_DBG(F("Setting resolution to"), _bitResolution, F("bits for"),
+               makeAddressString(_OneWireAddress));
+        if (!_dallasTemp->setResolution(_OneWireAddress, _bitResolution, true))
+        {
+            MS_DBG(F("Unable to set the resolution of this sensor:"),
+                   makeAddressString(_OneWireAddress));
+            // We're not setting the error bit if this fails because not all sensors
+            // have variable resolution.
+        }
     }
 
     // Tell the sensor that we do NOT want to wait for conversions to finish
     // That is, we're in ASYNC mode and will get values when we're ready
-    _internalDallasTemp.setWaitForConversion(false);
+    _dallasTemp->setWaitForConversion(false);
 
     // Turn the power back off it it had been turned on
     if (!wasOn) {powerDown();}
@@ -175,14 +347,26 @@ bool MaximDS18::startSingleMeasurement(void)
     // the timestamp and status bits.  If it returns false, there's no reason to go on.
     if (!Sensor::startSingleMeasurement()) return false;
 
-    // Send the command to get temperatures
-    MS_DBG(F("Asking DS18 to take a measurement"));
-    bool success = _internalDallasTemp.requestTemperaturesByAddress(_OneWireAddress);
+    bool success;
+    if (_bus != NULL)
+    {
+        // Start (or join) a conversion on every sensor on the bus at once
+        MS_DBG(F("Asking all DS18 on the bus to take a measurement"));
+        success = _bus->requestConversion(_busConversion);
+    }
+    else
+    {
+        // Send the command to get temperatures
+        MS_DBG(F("Asking DS18 to take a measurement"));
+        success = _internalWire->dallasTemp.requestTemperaturesByAddress(_OneWireAddress);
+    }
 
     if (success)
     {
         // Update the time that a measurement was requested
-        _millisMeasurementRequested = millis();
+        // For a sensor on a bus, this is the time the shared conversion began
+        if (_bus != NULL) _millisMeasurementRequested = _bus->getConversionStartTime();
+        else _millisMeasurementRequested = millis();
     }
     // Otherwise, make sure that the measurement start time and success bit (bit 6) are unset
     else
@@ -196,6 +380,31 @@ bool MaximDS18::startSingleMeasurement(void)
 }
 
 
+// This checks for the end of a conversion by reading a bit from the bus.
+// This only works for externally powered sensors - in parasite power mode the
+// bus is held high to power the conversion and the bit cannot be read.
+// NOTE:  The bit only shows the conversion of the last device addressed, and
+// reading any other device on the pin deselects it, after which the bit reads
+// as complete.  So the bit is only checked for a sensor alone on its pin;
+// sensors on a bus or sharing a pin wait their full conversion time, which is
+// set from each one's own resolution.
+bool MaximDS18::isMeasurementComplete(bool debug)
+{
+    // Check if the time has passed or the measurement was never started
+    if (Sensor::isMeasurementComplete(debug)) return true;
+
+    if (_bus == NULL && _aloneOnPin &&
+        !_dallasTemp->isParasitePowerMode() && _dallasTemp->isConversionComplete())
+    {
+        if (debug) {MS_DBG(F("Conversion by"), getSensorNameAndLocation(),
+                          F("finished early after"),
+                          millis() - _millisMeasurementRequested, F("ms"));}
+        return true;
+    }
+    return false;
+}
+
+
 bool MaximDS18::addSingleMeasurementResult(void)
 {
     bool success = false;
@@ -208,7 +417,7 @@ bool MaximDS18::addSingleMeasurementResult(void)
     if (bitRead(_sensorStatus, 6))
     {
         MS_DBG(getSensorNameAndLocation(), F("is reporting:"));
-        result = _internalDallasTemp.getTempC(_OneWireAddress);
+        result = _dallasTemp->getTempC(_OneWireAddress);
         MS_DBG(F("  Received"), result, F("°C"));
 
         // If a DS18 cannot get a good measurement, it returns 85
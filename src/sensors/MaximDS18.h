@@ -19,6 +19,12 @@
  *
  * Max time to take reading at 12-bit: 750ms
  * Reset time is < 480 µs
+ *
+ * When many DS18's share a single OneWire data pin, they can be attached to a
+ * MaximDS18Bus.  The bus object searches for devices only once and starts a
+ * temperature conversion on every device at the same time with a single
+ * Skip-ROM command, so the whole bus takes one 750ms conversion instead of
+ * 750ms per probe.
 */
 
 // Header Guards
@@ -44,33 +50,126 @@
 #define DS18_NUM_VARIABLES 1
 #define DS18_WARM_UP_TIME_MS 2
 #define DS18_STABILIZATION_TIME_MS 0
+// This is the measurement time at the default 12-bit resolution; the actual
+// measurement time is derived from the resolution set for each sensor
 #define DS18_MEASUREMENT_TIME_MS 750
+#define DS18_DEFAULT_BIT_RESOLUTION 12
 #define DS18_TEMP_VAR_NUM 0
 #define DS18_TEMP_RESOLUTION 4
 
+// The largest number of devices a single OneWire bus object will keep track of
+#define DS18_BUS_MAX_DEVICES 16
+// The maximum time after a bus-wide conversion is finished that another probe
+// on the bus may still collect the result without starting a new conversion
+#define DS18_BUS_RESULT_EXPIRY_MS 1000
+
+
+// A class to coordinate many DS18's sharing a single OneWire data pin
+// NOTE:  The bus object must be created BEFORE any sensors that use it
+class MaximDS18Bus
+{
+public:
+    MaximDS18Bus(int8_t powerPin, int8_t dataPin);
+    ~MaximDS18Bus();
+
+    int8_t getPowerPin(void){return _powerPin;}
+    int8_t getDataPin(void){return _dataPin;}
+
+    // This searches the bus for all attached devices
+    // The search is only done once, no matter how many sensors call this.
+    // The bus must be powered for this to succeed.
+    bool begin(void);
+    // This returns the number of devices found by begin()
+    uint8_t getDeviceCount(void){return _deviceCount;}
+    // This checks if a device was found at the given address
+    bool isPresent(DeviceAddress OneWireAddress);
+
+    // This starts a temperature conversion on every device on the bus at once
+    // with a single Skip-ROM Convert T command.  If a conversion is already
+    // in progress (or is finished but not yet read by the caller), the caller
+    // joins that conversion instead.  The conversion number the caller should
+    // read is returned in conversionNumber, which should hold the number of
+    // the conversion last read by the caller when the function is called.
+    bool requestConversion(uint16_t& conversionNumber);
+    // This returns the millis() timestamp the current conversion was started
+    uint32_t getConversionStartTime(void){return _millisConversionStarted;}
+
+    // The internal "Dallas Temperature" instance shared by all sensors on the bus
+    DallasTemperature *getDallasTemperature(void){return &_busDallasTemp;}
+
+private:
+    int8_t _powerPin;
+    int8_t _dataPin;
+    bool _searched;
+    uint8_t _deviceCount;
+    DeviceAddress _deviceAddresses[DS18_BUS_MAX_DEVICES];
+    uint16_t _conversionNumber;
+    uint32_t _millisConversionStarted;
+    OneWire _busOneWire;
+    DallasTemperature _busDallasTemp;
+};
+
+
+// The OneWire and "Dallas Temperature" instances for a sensor on its own pin
+// These are only created by the constructors that don't take a bus, so sensors
+// on a bus don't each carry an unused copy.
+struct MaximDS18Wire
+{
+    MaximDS18Wire(int8_t dataPin) : oneWire(dataPin), dallasTemp(&oneWire) {}
+    // Communicates with any OneWire devices (not just Maxim/Dallas
+    // temperature ICs)
+    OneWire oneWire;
+    // Communicates specifically with the temperature sensors
+    DallasTemperature dallasTemp;
+};
+
+
 // The main class for the DS18
 class MaximDS18 : public Sensor
 {
 public:
     MaximDS18(DeviceAddress OneWireAddress, int8_t powerPin, int8_t dataPin, uint8_t measurementsToAverage = 1);
     MaximDS18(int8_t powerPin, int8_t dataPin, uint8_t measurementsToAverage = 1);
+    // The constructor for a sensor on a shared OneWire bus - the power and
+    // data pins are taken from the bus
+    MaximDS18(DeviceAddress OneWireAddress, MaximDS18Bus& bus, uint8_t measurementsToAverage = 1);
     ~MaximDS18();
 
     bool setup(void) override;
     String getSensorLocation(void) override;
 
+    // These get and set the bit resolution of the sensor (9, 10, 11, or 12)
+    // The measurement time is derived from the resolution, halving for
+    // every bit less than 12.
+    // The new resolution is written to the sensor during setup, but only if
+    // it differs from the resolution already stored on the sensor.
+    void setBitResolution(uint8_t bitResolution);
+    uint8_t getBitResolution(void){return _bitResolution;}
+
     bool startSingleMeasurement(void) override;
     bool addSingleMeasurementResult(void) override;
 
+    // Externally powered sensors pull the bus low until their conversion is
+    // finished, so we can check for an early finish instead of waiting the
+    // full conversion time.  This is only done for a sensor that is alone on
+    // its pin; reading any other device on the pin ends the check, so on a
+    // shared pin each sensor waits its full conversion time.
+    bool isMeasurementComplete(bool debug=false) override;
+
 private:
     DeviceAddress _OneWireAddress;
     bool _addressKnown;
-    // Setup an internal OneWire instance to communicate with any OneWire devices
-    // (not just Maxim/Dallas temperature ICs)
-    OneWire _internalOneWire;
-    // Set up the internal a "Dallas Temperature" instance for communication
-    // specifically with the temperature sensors.
-    DallasTemperature _internalDallasTemp;
+    // True if setup found no other devices on the pin
+    bool _aloneOnPin;
+    uint8_t _bitResolution;
+    // The sensor's own OneWire instances; NULL if the sensor is on a bus
+    MaximDS18Wire *_internalWire;
+    // The shared bus, if the sensor is on one, and the number of the last
+    // bus-wide conversion this sensor has joined
+    MaximDS18Bus *_bus;
+    uint16_t _busConversion;
+    // Points to either the internal or the bus "Dallas Temperature" instance
+    DallasTemperature *_dallasTemp;
     // Turns the address into a printable string
     String makeAddressString(DeviceAddress OneWireAddress);
 };
@@ -34,6 +34,15 @@
 */
 
 #include "MeaSpecMS5803.h"
+#include <Wire.h>
+
+// MS5803 commands
+#define MS5803_CMD_ADC_READ 0x00
+#define MS5803_CMD_ADC_CONV 0x40
+#define MS5803_CMD_ADC_D1 0x00  // Pressure
+#define MS5803_CMD_ADC_D2 0x10  // Temperature
+#define MS5803_CMD_ADC_4096 0x08  // Oversampling ratio
+#define MS5803_CMD_PROM 0xA0
 
 
 // The constructor - because this is I2C, only need the power pin
@@ -45,6 +54,11 @@ MeaSpecMS5803::MeaSpecMS5803(int8_t powerPin, uint8_t i2cAddressHex,
 {
     _i2cAddressHex = i2cAddressHex;
     _maxPressure = maxPressure;
+    for (uint8_t i = 0; i < 8; i++) _coefficients[i] = 0;
+    _conversionState = MS5803_IDLE;
+    _millisConversionStarted = 0;
+    _rawPressure = 0;
+    _rawTemperature = 0;
 }
 // Destructor
 MeaSpecMS5803::~MeaSpecMS5803(){}
@@ -71,6 +85,18 @@ bool MeaSpecMS5803::setup(void)
     MS5803_internal.begin(_i2cAddressHex, _maxPressure);
     MS5803_internal.reset();
 
+    // Keep our own copy of the calibration coefficients so the conversions
+    // can be started and read without waiting inside the library.
+    if (!readCoefficients())
+    {
+        MS_DBG(F("Unable to read calibration coefficients from"), getSensorNameAndLocation());
+        // Set the status error bit (bit 7)
+        _sensorStatus |= 0b10000000;
+        // UN-set the set-up bit (bit 0) since setup failed!
+        _sensorStatus &= 0b11111110;
+        retVal = false;
+    }
+
     // Turn the power back off it it had been turned on
     if (!wasOn) {powerDown();}
 
@@ -78,6 +104,66 @@ bool MeaSpecMS5803::setup(void)
 }
 
 
+bool MeaSpecMS5803::startSingleMeasurement(void)
+{
+    // Sensor::startSingleMeasurement() checks that if it's awake/active and sets
+    // the timestamp and status bits.  If it returns false, there's no reason to go on.
+    if (!Sensor::startSingleMeasurement()) return false;
+
+    _conversionState = MS5803_IDLE;
+    if (!sendCommand(MS5803_CMD_ADC_CONV + MS5803_CMD_ADC_D1 + MS5803_CMD_ADC_4096))
+    {
+        MS_DBG(getSensorNameAndLocation(), F("did not successfully start a measurement."));
+        _millisMeasurementRequested = 0;
+        _sensorStatus &= 0b10111111;
+        return false;
+    }
+    _conversionState = MS5803_CONVERTING_D1;
+    _millisConversionStarted = millis();
+    return true;
+}
+
+
+bool MeaSpecMS5803::isMeasurementComplete(bool debug)
+{
+    // If a measurement failed to start, the sensor will never return a result
+    if (!bitRead(_sensorStatus, 6)) return true;
+
+    switch (_conversionState)
+    {
+        case MS5803_CONVERTING_D1:
+        {
+            if (millis() - _millisConversionStarted < MS5803_CONVERSION_TIME_MS) return false;
+            _rawPressure = readADC();
+            // Start the temperature conversion right away
+            if (!sendCommand(MS5803_CMD_ADC_CONV + MS5803_CMD_ADC_D2 + MS5803_CMD_ADC_4096))
+            {
+                _rawTemperature = 0;
+                _conversionState = MS5803_CONVERSIONS_DONE;
+                return true;
+            }
+            _conversionState = MS5803_CONVERTING_D2;
+            _millisConversionStarted = millis();
+            return false;
+        }
+        case MS5803_CONVERTING_D2:
+        {
+            if (millis() - _millisConversionStarted < MS5803_CONVERSION_TIME_MS) return false;
+            _rawTemperature = readADC();
+            _conversionState = MS5803_CONVERSIONS_DONE;
+            if (debug)
+            {
+                MS_DBG(getSensorNameAndLocation(), F("finished both conversions after"),
+                       millis() - _millisMeasurementRequested, F("ms"));
+            }
+            return true;
+        }
+        default:
+            return true;
+    }
+}
+
+
 bool MeaSpecMS5803::addSingleMeasurementResult(void)
 {
     bool success = false;
@@ -91,12 +177,17 @@ bool MeaSpecMS5803::addSingleMeasurementResult(void)
     if (bitRead(_sensorStatus, 6))
     {
         MS_DBG(getSensorNameAndLocation(), F("is reporting:"));
-        // Read values
-        // NOTE:  These functions actually include the request to begin
-        // a measurement and the wait for said measurement to finish.
-        // It's pretty fast (max of 11 ms) so we'll just wait.
-        temp = MS5803_internal.getTemperature(CELSIUS, ADC_512);
-        press = MS5803_internal.getPressure(ADC_4096);
+
+        // Finish the conversions if we somehow got here early
+        while (!isMeasurementComplete()) {}
+
+        // The ADC returns 0 when a conversion wasn't finished or the sensor
+        // is disconnected, which is highly unlikely to be a real value.
+        if (_rawPressure != 0 && _rawTemperature != 0)
+        {
+            calculateResults(temp, press);
+        }
+        MS_DBG(F("  D1:"), _rawPressure, F("D2:"), _rawTemperature);
 
         if (isnan(temp)) temp = -9999;
         if (isnan(press)) press = -9999;
@@ -110,6 +201,7 @@ bool MeaSpecMS5803::addSingleMeasurementResult(void)
             temp = -9999;
             press = -9999;
         }
+        success = (temp != -9999);
 
         MS_DBG(F("  Temperature:"), temp);
         MS_DBG(F("  Pressure:"), press);
@@ -119,6 +211,7 @@ bool MeaSpecMS5803::addSingleMeasurementResult(void)
     verifyAndAddMeasurementResult(MS5803_TEMP_VAR_NUM, temp);
     verifyAndAddMeasurementResult(MS5803_PRESSURE_VAR_NUM, press);
 
+    _conversionState = MS5803_IDLE;
     // Unset the time stamp for the beginning of this measurement
     _millisMeasurementRequested = 0;
     // Unset the status bits for a measurement request (bits 5 & 6)
@@ -126,3 +219,142 @@ bool MeaSpecMS5803::addSingleMeasurementResult(void)
 
     return success;
 }
+
+
+bool MeaSpecMS5803::sendCommand(uint8_t command)
+{
+    Wire.beginTransmission(_i2cAddressHex);
+    Wire.write(command);
+    return !Wire.endTransmission();
+}
+
+
+// This reads the 24-bit result of the last conversion
+uint32_t MeaSpecMS5803::readADC(void)
+{
+    if (!sendCommand(MS5803_CMD_ADC_READ)) return 0;
+    if (Wire.requestFrom(_i2cAddressHex, (uint8_t)3) != 3) return 0;
+    uint32_t result = (uint32_t)Wire.read() << 16;
+    result |= (uint32_t)Wire.read() << 8;
+    result |= Wire.read();
+    return result;
+}
+
+
+bool MeaSpecMS5803::readCoefficients(void)
+{
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        if (!sendCommand(MS5803_CMD_PROM + i*2)) return false;
+        if (Wire.requestFrom(_i2cAddressHex, (uint8_t)2) != 2) return false;
+        _coefficients[i] = (uint16_t)Wire.read() << 8;
+        _coefficients[i] |= Wire.read();
+    }
+    // All 0's or all 1's means nothing is there
+    return _coefficients[1] != 0 && _coefficients[1] != 0xFFFF;
+}
+
+
+// This applies the first and second order compensation from the datasheet
+// for each sensor range to get the temperature in °C and pressure in mbar
+void MeaSpecMS5803::calculateResults(float& temp, float& press)
+{
+    const int64_t C1 = _coefficients[1], C2 = _coefficients[2], C3 = _coefficients[3];
+    const int64_t C4 = _coefficients[4], C5 = _coefficients[5], C6 = _coefficients[6];
+
+    int32_t dT = (int32_t)_rawTemperature - (int32_t)(C5 << 8);
+    int32_t TEMP = 2000 + (int32_t)(((int64_t)dT*C6) >> 23);
+    int64_t dT2 = (int64_t)dT*dT;
+    int64_t lowT2 = (int64_t)(TEMP - 2000)*(TEMP - 2000);
+    int64_t veryLowT2 = (int64_t)(TEMP + 1500)*(TEMP + 1500);
+
+    int64_t OFF, SENS;
+    int64_t T2 = 0, OFF2 = 0, SENS2 = 0;
+    uint8_t pShift = 15;
+    float pDivisor = 10.0;  // 0.1 mbar resolution
+
+    switch (_maxPressure)
+    {
+        case 1:
+        {
+            OFF = (C2 << 16) + ((C4*dT) >> 7);
+            SENS = (C1 << 15) + ((C3*dT) >> 8);
+            pDivisor = 100.0;
+            if (TEMP < 2000)
+            {
+                T2 = dT2 >> 31;
+                OFF2 = 3*lowT2;
+                SENS2 = (7*lowT2) >> 3;
+                if (TEMP < -1500) SENS2 += 2*veryLowT2;
+            }
+            else if (TEMP > 4500)
+            {
+                SENS2 -= (int64_t)(TEMP - 4500)*(TEMP - 4500) >> 3;
+            }
+            break;
+        }
+        case 2:
+        {
+            OFF = (C2 << 17) + ((C4*dT) >> 6);
+            SENS = (C1 << 16) + ((C3*dT) >> 7);
+            pDivisor = 100.0;
+            if (TEMP < 2000)
+            {
+                T2 = dT2 >> 31;
+                OFF2 = (61*lowT2) >> 4;
+                SENS2 = 2*lowT2;
+                if (TEMP < -1500)
+                {
+                    OFF2 += 20*veryLowT2;
+                    SENS2 += 12*veryLowT2;
+                }
+            }
+            break;
+        }
+        case 5:
+        {
+            OFF = (C2 << 18) + ((C4*dT) >> 5);
+            SENS = (C1 << 17) + ((C3*dT) >> 7);
+            pDivisor = 100.0;
+            if (TEMP < 2000)
+            {
+                T2 = (3*dT2) >> 33;
+                OFF2 = (3*lowT2) >> 3;
+                SENS2 = (7*lowT2) >> 3;
+                if (TEMP < -1500) SENS2 += 3*veryLowT2;
+            }
+            break;
+        }
+        default:  // 14 and 30 bar
+        {
+            OFF = (C2 << 16) + ((C4*dT) >> 7);
+            SENS = (C1 << 15) + ((C3*dT) >> 8);
+            if (_maxPressure == 30) pShift = 13;
+            if (TEMP < 2000)
+            {
+                T2 = (3*dT2) >> 33;
+                OFF2 = (3*lowT2) >> 1;
+                SENS2 = (5*lowT2) >> 3;
+                if (TEMP < -1500)
+                {
+                    OFF2 += 7*veryLowT2;
+                    SENS2 += 4*veryLowT2;
+                }
+            }
+            else
+            {
+                T2 = (7*dT2) >> 37;
+                OFF2 = lowT2 >> 4;
+            }
+            break;
+        }
+    }
+
+    TEMP -= (int32_t)T2;
+    OFF -= OFF2;
+    SENS -= SENS2;
+    int32_t P = (int32_t)(((((int64_t)_rawPressure*SENS) >> 21) - OFF) >> pShift);
+
+    temp = TEMP/100.0;
+    press = P/pDivisor;
+}
@@ -63,7 +63,9 @@
 #define MS5803_NUM_VARIABLES 2
 #define MS5803_WARM_UP_TIME_MS 10
 #define MS5803_STABILIZATION_TIME_MS 0
-#define MS5803_MEASUREMENT_TIME_MS 10
+#define MS5803_MEASUREMENT_TIME_MS 20  // Two conversions at OSR 4096
+// The maximum conversion time for one ADC conversion at OSR 4096 is 9.04ms
+#define MS5803_CONVERSION_TIME_MS 10
 
 #define MS5803_TEMP_RESOLUTION 2
 #define MS5803_TEMP_VAR_NUM 0
@@ -83,11 +85,38 @@ public:
     bool setup(void) override;
     String getSensorLocation(void) override;
 
+    // This starts the pressure (D1) conversion
+    bool startSingleMeasurement(void) override;
     bool addSingleMeasurementResult(void) override;
+
+    // This steps through the two conversions:  once the pressure (D1)
+    // conversion is done, it is read and the temperature (D2) conversion is
+    // started.  It returns true once both are read.
+    bool isMeasurementComplete(bool debug=false) override;
+
 protected:
     MS5803 MS5803_internal;
     uint8_t _i2cAddressHex;
     int16_t _maxPressure;
+
+private:
+    // The calibration coefficients from the sensor PROM
+    uint16_t _coefficients[8];
+    // The state of the conversions for the current measurement
+    enum {
+        MS5803_IDLE,
+        MS5803_CONVERTING_D1,
+        MS5803_CONVERTING_D2,
+        MS5803_CONVERSIONS_DONE
+    } _conversionState;
+    uint32_t _millisConversionStarted;
+    uint32_t _rawPressure;  // D1
+    uint32_t _rawTemperature;  // D2
+
+    bool sendCommand(uint8_t command);
+    uint32_t readADC(void);
+    bool readCoefficients(void);
+    void calculateResults(float& temp, float& press);
 };
 
 
@@ -14,6 +14,7 @@
 */
 
 #include "YosemitechParent.h"
+#include "SensorTelemetry.h"
 
 // The constructor - need the sensor type, modbus address, power pin, stream for data, and number of readings to average
 YosemitechParent::YosemitechParent(byte modbusAddress, Stream* stream,
@@ -167,9 +168,9 @@ void YosemitechParent::powerUp(void)
     {
         MS_DBG(F("Powering"), getSensorNameAndLocation(),
                F("with pin"), _powerPin);
-        digitalWrite(_powerPin, HIGH);
-        // Mark the time that the sensor was powered
-        _millisPowerOn = millis();
+        // Mark the time that the sensor was powered - or that the rail it
+        // shares came up, if it was already on
+        holdPower();
     }
     if (_powerPin2 >= 0)
     {
@@ -182,6 +183,7 @@ void YosemitechParent::powerUp(void)
         MS_DBG(F("Power to"), getSensorNameAndLocation(),
                F("is not controlled by this library."));
     }
+    if (_telemetry != NULL) _telemetry->powerOn(millis());
     // Set the status bit for sensor power attempt (bit 1) and success (bit 2)
     _sensorStatus |= 0b00000110;
 }
@@ -194,7 +196,8 @@ void YosemitechParent::powerDown(void)
     {
         MS_DBG(F("Turning off power to"), getSensorNameAndLocation(),
                F("with pin"), _powerPin);
-        digitalWrite(_powerPin, LOW);
+        releasePower();
+        if (_telemetry != NULL) _telemetry->powerOff(millis());
         // Unset the power-on time
         _millisPowerOn = 0;
         // Unset the activation time